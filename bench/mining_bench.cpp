@@ -0,0 +1,450 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/** \file mining_bench.cpp - microbenchmarks of the mining kernels: parsing,
+ * VAT intersections, minimum DFS code checks and level_one_hmap inserts.
+ *
+ * Fixtures are built from data/GRAPH_small.dat and data/GRAPH_large.dat with
+ * fixed seeds, so numbers are comparable between runs and between commits.
+ * Throughput is reported as bytes/s (parsing), and items/s: embeddings
+ * produced (intersections), codes (minimality checks) and inserts. */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sys/stat.h>
+#include <vector>
+
+unsigned long int freq_pats_count = 0;
+bool print = false;
+
+#include "count_support.h"
+#include "graph_arena_vat.h"
+#include "graph_can_code.h"
+#include "graph_iso_check.h"
+#include "graph_operators.h"
+#include "graph_vat.h"
+#include "pattern.h"
+#include "random_max-graph.h"
+
+#include "db_reader.h"
+#include "graph_tokenizer.h"
+#include "level_one_hmap.h"
+#include "pat_fam.h"
+
+#include "mem_storage_manager.h"
+
+#ifndef DATA_DIR
+#define DATA_DIR "../data"
+#endif
+
+#define GRAPH_PR proplist<undirected>
+#define GRAPH_MINE_PR proplist<Fk_F1, proplist<vert_mine>>
+#define DMTL_TKNZ_PR proplist<dmtl_format>
+
+typedef adj_list<dict_label, dict_label> PAT_ST;
+typedef pattern<GRAPH_PR, GRAPH_MINE_PR, PAT_ST, canonical_code> GRAPH_PAT;
+typedef GRAPH_PAT::VERTEX_T V_T;
+typedef GRAPH_PAT::EDGE_T E_T;
+typedef map<pair<pair<V_T, V_T>, E_T>, int> EDGE_FREQ;
+typedef pattern_support<GRAPH_MINE_PR> PAT_SUP;
+
+static const char *const DB_NAMES[] = {"GRAPH_small.dat", "GRAPH_large.dat"};
+
+static std::string db_path(const int &db) {
+  const char *dir = getenv("ORIGAMI_DATA");
+  return std::string(dir ? dir : DATA_DIR) + "/" + DB_NAMES[db];
+}
+
+static size_t file_size(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+/** Number of embeddings in a VAT, for either layout */
+static unsigned long num_embeddings(
+    const vat<GRAPH_PR, GRAPH_MINE_PR, arena_storage> *v) {
+  unsigned long n = 0;
+  for (auto it = v->begin(); it != v->end(); it++)
+    n += it->count;
+  return n;
+}
+
+static unsigned long
+num_embeddings(const vat<GRAPH_PR, GRAPH_MINE_PR, std::vector> *v) {
+  unsigned long n = 0;
+  for (auto it = v->begin(); it != v->end(); it++)
+    n += it->second.size();
+  return n;
+}
+
+/** Level-one patterns and VATs of a database */
+template <template <typename, typename> class VAT_ST> struct db_fixture {
+  typedef vat<GRAPH_PR, GRAPH_MINE_PR, VAT_ST> VAT;
+  typedef storage_manager<GRAPH_PAT, VAT, memory_storage> VAT_MAP;
+
+  /** One intersection, of v1 with the single edge v2 */
+  struct join {
+    const VAT *v1;
+    const VAT *v2;
+    pair<int, int> vids;
+    bool isfwd;
+  };
+
+  pat_fam<GRAPH_PAT> pats;
+  VAT_MAP vats;
+  EDGE_FREQ edge_freq;
+  vector<join> fwd, back;
+  vector<join> any; // forward joins, whether frequent or not
+  unsigned long fwd_embeddings, back_embeddings; // produced by one pass
+  vector<VAT *> owned; // VATs of the two-edge patterns joined in back
+
+  explicit db_fixture(const int &db) : fwd_embeddings(0), back_embeddings(0) {
+    std::string path = db_path(db);
+    db_reader<GRAPH_PAT, DMTL_TKNZ_PR> dbr(path.c_str());
+    dbr.get_length_one(pats, vats, 1, edge_freq);
+    make_joins();
+  }
+
+  ~db_fixture() {
+    for (unsigned int i = 0; i < owned.size(); i++)
+      delete owned[i];
+    for (unsigned int i = 0; i < pats.size(); i++) {
+      vats.delete_vat(pats[i]);
+      delete pats[i];
+    }
+  }
+
+  /**
+   * Forward joins extend a level-one pattern at one end by a level-one edge
+   * with a matching label; back joins close the resulting paths into
+   * triangles. Up to 64 of each are kept, picked with a fixed seed.
+   */
+  void make_joins() {
+    PAT_SUP sup;
+    PAT_SUP *sups[1] = {&sup};
+    GRAPH_PAT **no_pats = 0;
+
+    // level-one edges by the label of each of their ends
+    multimap<V_T, unsigned int> by_label;
+    for (unsigned int i = 0; i < pats.size(); i++) {
+      by_label.insert(make_pair(pats[i]->label(0), i));
+      if (pats[i]->label(1) != pats[i]->label(0))
+        by_label.insert(make_pair(pats[i]->label(1), i));
+    }
+
+    vector<join> all_fwd;
+    vector<pair<join, V_T>> paths; // label of the new vertex
+    for (unsigned int i = 0; i < pats.size(); i++) {
+      for (int v = 0; v < 2; v++) {
+        V_T lbl = pats[i]->label(v);
+        auto r = by_label.equal_range(lbl);
+        for (auto it = r.first; it != r.second; it++) {
+          GRAPH_PAT *e = pats[it->second];
+          join j = {vats.get_vat(pats[i]), vats.get_vat(e), make_pair(v, 2),
+                    true};
+          all_fwd.push_back(j);
+          V_T other = (e->label(0) == lbl) ? e->label(1) : e->label(0);
+          paths.push_back(make_pair(j, other));
+        }
+      }
+    }
+
+    std::mt19937 rng(42);
+    shuffle(all_fwd.begin(), all_fwd.end(), rng);
+    any.assign(all_fwd.begin(),
+               all_fwd.begin() + min<size_t>(all_fwd.size(), 1024));
+    for (unsigned int i = 0; i < all_fwd.size() && fwd.size() < 64; i++)
+      if (!empty_join(all_fwd[i], sups, no_pats))
+        fwd.push_back(all_fwd[i]);
+
+    shuffle(paths.begin(), paths.end(), rng);
+    for (unsigned int i = 0; i < paths.size() && back.size() < 64; i++) {
+      const join &j = paths[i].first;
+      VAT **path = VAT::intersection(j.v1, j.v2, sups, no_pats, true, j.vids, 1);
+      if (!path)
+        continue;
+      VAT *pv = path[0];
+      delete path;
+
+      // the end of the first edge that was not extended, and the new vertex
+      int u = 1 - j.vids.first;
+      V_T lu = label_of(j.v1, u);
+      vector<GRAPH_PAT *> closing = find_edges(lu, paths[i].second);
+      bool kept = false;
+      for (unsigned int k = 0; k < closing.size() && back.size() < 64; k++) {
+        join b = {pv, vats.get_vat(closing[k]), make_pair(2, u), false};
+        if (!empty_join(b, sups, no_pats)) {
+          back.push_back(b);
+          kept = true;
+        }
+      }
+      if (kept)
+        owned.push_back(pv);
+      else
+        delete pv;
+    }
+
+    for (unsigned int i = 0; i < fwd.size(); i++)
+      fwd_embeddings += count_join(fwd[i], sups, no_pats);
+    for (unsigned int i = 0; i < back.size(); i++)
+      back_embeddings += count_join(back[i], sups, no_pats);
+  }
+
+  /** Embeddings in the result of a join */
+  unsigned long count_join(const join &j, PAT_SUP **sups, GRAPH_PAT **no_pats) {
+    VAT **c =
+        VAT::intersection(j.v1, j.v2, sups, no_pats, j.isfwd, j.vids, 1);
+    if (!c)
+      return 0;
+    unsigned long n = num_embeddings(c[0]);
+    delete c[0];
+    delete c; // allocated as a single slot
+    return n;
+  }
+
+  bool empty_join(const join &j, PAT_SUP **sups, GRAPH_PAT **no_pats) {
+    return count_join(j, sups, no_pats) == 0;
+  }
+
+  V_T label_of(const VAT *v, const int &vid) {
+    for (unsigned int i = 0; i < pats.size(); i++)
+      if (vats.get_vat(pats[i]) == v)
+        return pats[i]->label(vid);
+    return V_T();
+  }
+
+  /** Level-one patterns with end labels a and b */
+  vector<GRAPH_PAT *> find_edges(const V_T &a, const V_T &b) {
+    vector<GRAPH_PAT *> found;
+    for (unsigned int i = 0; i < pats.size(); i++)
+      if ((pats[i]->label(0) == a && pats[i]->label(1) == b) ||
+          (pats[i]->label(0) == b && pats[i]->label(1) == a))
+        found.push_back(pats[i]);
+    return found;
+  }
+};
+
+/** Fixtures are built once, on first use */
+template <template <typename, typename> class VAT_ST>
+static db_fixture<VAT_ST> &fixture(const int &db) {
+  static db_fixture<VAT_ST> *f[2] = {0, 0};
+  if (!f[db])
+    f[db] = new db_fixture<VAT_ST>(db);
+  return *f[db];
+}
+
+/** Reads a whole database into level-one patterns and VATs */
+static void BM_ParseAscii(benchmark::State &state) {
+  typedef vat<GRAPH_PR, GRAPH_MINE_PR, arena_storage> VAT;
+  std::string path = db_path(state.range(0));
+  unsigned int threads = state.range(1);
+
+  for (auto _ : state) {
+    pat_fam<GRAPH_PAT> pats;
+    storage_manager<GRAPH_PAT, VAT, memory_storage> vats;
+    EDGE_FREQ edge_freq;
+    db_reader<GRAPH_PAT, DMTL_TKNZ_PR> dbr(path.c_str());
+    dbr.get_length_one(pats, vats, 1, edge_freq, threads);
+
+    state.PauseTiming();
+    for (unsigned int i = 0; i < pats.size(); i++) {
+      vats.delete_vat(pats[i]);
+      delete pats[i];
+    }
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(state.iterations() * file_size(path));
+}
+BENCHMARK(BM_ParseAscii)
+    ->ArgNames({"db", "threads"})
+    ->Args({0, 1})
+    ->Args({1, 1})
+    ->Args({1, 4})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/** Runs the forward or back joins of a fixture */
+template <template <typename, typename> class VAT_ST>
+static void BM_Intersect(benchmark::State &state, const bool &isfwd) {
+  typedef typename db_fixture<VAT_ST>::VAT VAT;
+  db_fixture<VAT_ST> &f = fixture<VAT_ST>(state.range(0));
+  const vector<typename db_fixture<VAT_ST>::join> &joins =
+      isfwd ? f.fwd : f.back;
+  if (joins.empty()) {
+    state.SkipWithError("no joins in this database");
+    return;
+  }
+
+  PAT_SUP sup;
+  PAT_SUP *sups[1] = {&sup};
+  GRAPH_PAT **no_pats = 0;
+  for (auto _ : state) {
+    for (unsigned int i = 0; i < joins.size(); i++) {
+      const typename db_fixture<VAT_ST>::join &j = joins[i];
+      VAT **c = VAT::intersection(j.v1, j.v2, sups, no_pats, j.isfwd, j.vids, 1);
+      if (!c)
+        continue;
+      delete c[0];
+      delete c;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          (isfwd ? f.fwd_embeddings : f.back_embeddings));
+  state.SetLabel("items = embeddings");
+}
+
+template <template <typename, typename> class VAT_ST>
+static void BM_FwdIntersect(benchmark::State &state) {
+  BM_Intersect<VAT_ST>(state, true);
+}
+
+template <template <typename, typename> class VAT_ST>
+static void BM_BackIntersect(benchmark::State &state) {
+  BM_Intersect<VAT_ST>(state, false);
+}
+
+BENCHMARK_TEMPLATE(BM_FwdIntersect, arena_storage)->ArgName("db")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_FwdIntersect, std::vector)->ArgName("db")->Arg(0)->Arg(1);
+// GRAPH_small has no triangles to close
+BENCHMARK_TEMPLATE(BM_BackIntersect, arena_storage)->ArgName("db")->Arg(1);
+BENCHMARK_TEMPLATE(BM_BackIntersect, std::vector)->ArgName("db")->Arg(1);
+
+/** Support checks of candidates that turn out infrequent: every join is
+ * rejected on its tid count */
+template <template <typename, typename> class VAT_ST>
+static void BM_RejectIntersect(benchmark::State &state) {
+  typedef typename db_fixture<VAT_ST>::VAT VAT;
+  db_fixture<VAT_ST> &f = fixture<VAT_ST>(state.range(0));
+  PAT_SUP sup;
+  PAT_SUP *sups[1] = {&sup};
+  GRAPH_PAT **no_pats = 0;
+  const int minsup = 1 << 30;
+  for (auto _ : state) {
+    for (unsigned int i = 0; i < f.any.size(); i++) {
+      const typename db_fixture<VAT_ST>::join &j = f.any[i];
+      VAT **c =
+          VAT::intersection(j.v1, j.v2, sups, no_pats, j.isfwd, j.vids, minsup);
+      benchmark::DoNotOptimize(c);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * f.any.size());
+  state.SetLabel("items = candidates");
+}
+BENCHMARK_TEMPLATE(BM_RejectIntersect, arena_storage)
+    ->ArgName("db")
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK_TEMPLATE(BM_RejectIntersect, std::vector)
+    ->ArgName("db")
+    ->Arg(0)
+    ->Arg(1);
+
+/**
+ * Random connected patterns over the level-one edges of GRAPH_large, with
+ * the given number of vertices: each step adds a forward edge, or with
+ * probability 1/3 a back edge, chosen with a fixed seed.
+ */
+static vector<GRAPH_PAT *> random_patterns(const unsigned int &nv,
+                                           const unsigned int &count) {
+  db_fixture<arena_storage> &f = fixture<arena_storage>(1);
+  const pat_fam<GRAPH_PAT> &l1 = f.pats;
+  std::mt19937 rng(42);
+  vector<GRAPH_PAT *> pats;
+
+  while (pats.size() < count) {
+    const GRAPH_PAT *first = l1[rng() % l1.size()];
+    E_T e;
+    first->get_out_edge(0, 1, e);
+    GRAPH_PAT *p = new GRAPH_PAT;
+    make_edge(p, first->label(0), first->label(1), e);
+
+    for (unsigned int tries = 0; p->size() < nv && tries < 50 * nv; tries++) {
+      int v = rng() % p->size();
+      const GRAPH_PAT *l = l1[rng() % l1.size()];
+      int end = (l->label(0) == p->label(v)) ? 0
+                : (l->label(1) == p->label(v)) ? 1
+                                               : -1;
+      if (end == -1)
+        continue;
+      V_T other = l->label(1 - end);
+      l->get_out_edge(0, 1, e);
+
+      int dest = -1;
+      if (rng() % 3 == 0) { // back edge, to a vertex with the right label
+        vector<int> *ids = p->get_vids_for_this_label(other);
+        E_T tmp;
+        for (unsigned int k = 0; k < ids->size(); k++)
+          if ((*ids)[k] != v && !p->get_out_edge(v, (*ids)[k], tmp))
+            dest = (*ids)[k];
+        delete ids;
+        if (dest == -1)
+          continue;
+      } else {
+        dest = p->add_vertex(other);
+      }
+      p->add_out_edge(v, dest, e);
+      p->add_out_edge(dest, v, e);
+    }
+    pats.push_back(p);
+  }
+  return pats;
+}
+
+static void BM_MinDfsCheck(benchmark::State &state) {
+  vector<GRAPH_PAT *> pats = random_patterns(state.range(0), 64);
+  unsigned long codes = 0;
+  for (auto _ : state) {
+    for (unsigned int i = 0; i < pats.size(); i++) {
+      GRAPH_PAT::CAN_CODE cc = check_isomorphism(pats[i]);
+      benchmark::DoNotOptimize(cc);
+    }
+    codes += pats.size();
+  }
+  state.SetItemsProcessed(codes);
+  state.SetLabel("items = codes");
+  for (unsigned int i = 0; i < pats.size(); i++)
+    delete pats[i];
+}
+BENCHMARK(BM_MinDfsCheck)->ArgName("vertices")->Arg(4)->Arg(8)->Arg(16)->Arg(32);
+
+static void BM_LevelOneInsert(benchmark::State &state) {
+  db_fixture<arena_storage> &f = fixture<arena_storage>(state.range(0));
+  unsigned long inserts = 0;
+  for (auto _ : state) {
+    level_one_hmap<V_T, E_T> l1map;
+    for (unsigned int i = 0; i < f.pats.size(); i++) {
+      E_T e;
+      f.pats[i]->get_out_edge(0, 1, e);
+      l1map.insert(f.pats[i]->label(0), f.pats[i]->label(1), e);
+      l1map.insert(f.pats[i]->label(1), f.pats[i]->label(0), e);
+    }
+    inserts += 2 * f.pats.size();
+    benchmark::DoNotOptimize(l1map);
+  }
+  state.SetItemsProcessed(inserts);
+  state.SetLabel("items = inserts");
+}
+BENCHMARK(BM_LevelOneInsert)->ArgName("db")->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
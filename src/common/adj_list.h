@@ -21,6 +21,7 @@
 #ifndef _ADJ_LIST
 #define _ADJ_LIST
 
+#include "alloc_policy.h"
 #include <algorithm>
 #include <iostream>
 #include <map>
@@ -29,7 +30,6 @@
 #include <utility> // For std::pair
 
 using namespace std;
-template <typename T> using ALLOC = std::allocator<T>;
 
 template <typename VERTEX_T, typename EDGE_T> struct vertex_info;
 
@@ -186,17 +186,9 @@ public:
   typedef std::pair<EIT, EIT> EIT_PAIR;
   typedef std::pair<CONST_EIT, CONST_EIT> CONST_EIT_PAIR;
 
-  void *operator new(size_t size) {
-    ALLOC<ADJ_L> aa;
-    return aa.allocate(size);
-  }
+  void *operator new(size_t size) { return alloc_bytes<ALLOC>(size); }
 
-  void operator delete(void *p, size_t size) {
-    if (p) {
-      ALLOC<ADJ_L> aa;
-      aa.deallocate(static_cast<ADJ_L *>(p), size);
-    }
-  }
+  void operator delete(void *p, size_t size) { free_bytes<ALLOC>(p, size); }
 
   // default constructor
   adj_list() {}
@@ -0,0 +1,387 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file alloc_policy.h - allocation policies behind the ALLOC alias used by
+ * the operator new/delete of patterns, VATs and adjacency lists */
+#ifndef _ALLOC_POLICY_H
+#define _ALLOC_POLICY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+/**
+ * \brief Policy that takes every block from the system heap.
+ */
+struct heap_policy {
+  static void *allocate(const size_t &bytes) { return ::operator new(bytes); }
+  static void deallocate(void *p, const size_t &) { ::operator delete(p); }
+};
+
+/**
+ * \brief Policy with a size-class pool per thread.
+ *
+ * Blocks of up to MAX_BYTES are rounded up to a multiple of GRAIN and taken
+ * from the free list of their class, which is refilled by carving CHUNK
+ * bytes from the heap at a time; larger blocks go to the heap. A block goes
+ * back on the free list of the thread that frees it, which need not be the
+ * one that allocated it (VATs are shared by the walks). A thread keeps at
+ * most 2 * BATCH free blocks of a class: past that, BATCH of them move to a
+ * depot shared by all threads, where any thread refills from before it
+ * carves a new chunk. So blocks freed by one thread and allocated by another
+ * do not pile up on the first one.
+ *
+ * Chunks are never given back to the heap: the pool holds on to the peak of
+ * its small blocks until the process exits, and the free blocks of a thread
+ * that ends are lost with it. The per-thread state is plain data without a
+ * destructor, so that objects freed while the program exits still find it.
+ */
+struct pool_policy {
+  static constexpr size_t GRAIN = 16;
+  static constexpr size_t MAX_BYTES = 512;
+  static constexpr size_t CHUNK = 64 * 1024;
+  static constexpr unsigned int BATCH = 32;
+
+  static void *allocate(const size_t &bytes) {
+    if (bytes > MAX_BYTES || !bytes)
+      return ::operator new(bytes ? bytes : 1);
+    state &s = local();
+    size_t c = size_class(bytes);
+    if (!s.free[c])
+      refill(s, c);
+    void *p = s.free[c];
+    s.free[c] = *static_cast<void **>(p);
+    s.len[c]--;
+    return p;
+  }
+
+  static void deallocate(void *p, const size_t &bytes) {
+    if (bytes > MAX_BYTES || !bytes) {
+      ::operator delete(p);
+      return;
+    }
+    state &s = local();
+    size_t c = size_class(bytes);
+    *static_cast<void **>(p) = s.free[c];
+    s.free[c] = p;
+    if (++s.len[c] > 2 * BATCH)
+      give_back(s, c);
+  }
+
+private:
+  static constexpr size_t NUM_CLASSES = MAX_BYTES / GRAIN;
+  static_assert(GRAIN >= 2 * sizeof(void *), "a batch is chained by the "
+                                             "second word of its first block");
+
+  struct state {
+    void *free[NUM_CLASSES];       // free list of each class
+    unsigned int len[NUM_CLASSES]; // blocks on each list
+    char *cur, *end;               // rest of the last chunk
+  };
+
+  struct depot {
+    std::mutex lock;
+    void *batches[NUM_CLASSES]; // lists of BATCH blocks of each class
+  };
+
+  static state &local() {
+    static thread_local state s; // zero-initialized
+    return s;
+  }
+
+  static depot &shared() {
+    static depot d;
+    return d;
+  }
+
+  // moves BATCH blocks of class c from the list of this thread to the depot
+  static void give_back(state &s, const size_t &c) {
+    void *batch = s.free[c], *last = batch;
+    for (unsigned int k = 1; k < BATCH; k++)
+      last = *static_cast<void **>(last);
+    s.free[c] = *static_cast<void **>(last);
+    *static_cast<void **>(last) = 0;
+    s.len[c] -= BATCH;
+
+    depot &d = shared();
+    std::lock_guard<std::mutex> guard(d.lock);
+    static_cast<void **>(batch)[1] = d.batches[c];
+    d.batches[c] = batch;
+  }
+
+  static size_t size_class(const size_t &bytes) {
+    return (bytes + GRAIN - 1) / GRAIN - 1;
+  }
+
+  // puts blocks of class c on its empty list: a batch from the depot, or
+  // blocks from the current chunk or a new one
+  static void refill(state &s, const size_t &c) {
+    {
+      depot &d = shared();
+      std::lock_guard<std::mutex> guard(d.lock);
+      if (d.batches[c]) {
+        s.free[c] = d.batches[c];
+        d.batches[c] = static_cast<void **>(d.batches[c])[1];
+        s.len[c] = BATCH;
+        return;
+      }
+    }
+    size_t sz = (c + 1) * GRAIN;
+    if ((size_t)(s.end - s.cur) < sz) {
+      // what is left of the chunk goes to the list of its size
+      if (s.end - s.cur >= (ptrdiff_t)GRAIN) {
+        size_t r = (s.end - s.cur) / GRAIN - 1;
+        *reinterpret_cast<void **>(s.cur) = s.free[r];
+        s.free[r] = s.cur;
+        s.len[r]++;
+      }
+      s.cur = static_cast<char *>(::operator new(CHUNK));
+      s.end = s.cur + CHUNK;
+    }
+    for (unsigned int k = 0; k < 16 && (size_t)(s.end - s.cur) >= sz; k++) {
+      *reinterpret_cast<void **>(s.cur) = s.free[c];
+      s.free[c] = s.cur;
+      s.cur += sz;
+      s.len[c]++;
+    }
+  }
+};
+
+/**
+ * \brief Policy that serves the objects of a walk from a per-thread arena,
+ * released at once when the walk ends; P serves everything else.
+ *
+ * While a walk_scope is open on a thread, allocations bump a pointer in the
+ * thread's arena and freeing them does nothing; closing the outermost scope
+ * makes the whole arena free again. Only objects that die with the walk may
+ * be allocated this way; blocks taken before the scope, or outside of it,
+ * are handed to P as usual.
+ *
+ * The chunks of a thread's arena are kept from walk to walk, and given back
+ * to the heap when the thread exits, after its last walk_scope is closed.
+ */
+template <class P> struct walk_policy {
+  static void *allocate(const size_t &bytes) {
+    arena &a = local();
+    if (!a.depth)
+      return P::allocate(bytes);
+    size_t sz = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+    if ((size_t)(a.end - a.cur) < sz)
+      next_chunk(a, sz);
+    void *p = a.cur;
+    a.cur += sz;
+    return p;
+  }
+
+  static void deallocate(void *p, const size_t &bytes) {
+    if (!local().owns(p))
+      P::deallocate(p, bytes);
+  }
+
+  /** Opens a walk on this thread */
+  static void begin_walk() { local().depth++; }
+
+  /** Closes a walk; closing the outermost one frees all of the arena */
+  static void end_walk() {
+    arena &a = local();
+    if (--a.depth)
+      return;
+    a.in_use = a.first;
+    if (a.first) {
+      a.cur = a.first->data();
+      a.end = a.cur + a.first->size;
+    }
+  }
+
+private:
+  static constexpr size_t ALIGN = 16;
+  static constexpr size_t CHUNK = 256 * 1024;
+
+  struct chunk {
+    chunk *next;
+    size_t size; // usable bytes
+    char *data() { return reinterpret_cast<char *>(this) + HEADER; }
+  };
+  static constexpr size_t HEADER = (sizeof(chunk) + ALIGN - 1) / ALIGN * ALIGN;
+
+  struct arena {
+    chunk *first;  // all chunks, kept across walks
+    chunk *in_use; // chunk cur points into
+    char *cur, *end;
+    unsigned int depth;      // walk_scopes open
+    chunk **by_addr;         // all chunks again, in address order
+    unsigned int num, space; // chunks in by_addr, and room for
+
+    // a block of the current chunk, or else of the last chunk at or below it
+    bool owns(const void *p) const {
+      const char *q = static_cast<const char *>(p);
+      if (in_use && within(in_use, q))
+        return true;
+      chunk *const *c = std::upper_bound(
+          by_addr, by_addr + num, q,
+          [](const char *q, const chunk *c) { return q < (const char *)c; });
+      return c != by_addr && within(*(c - 1), q);
+    }
+
+    static bool within(const chunk *c, const char *q) {
+      const char *b = reinterpret_cast<const char *>(c) + HEADER;
+      return q >= b && q < b + c->size;
+    }
+
+    void add(chunk *c) {
+      if (num == space) {
+        space = space ? 2 * space : 16;
+        chunk **grown =
+            static_cast<chunk **>(::operator new(space * sizeof(chunk *)));
+        if (num)
+          memcpy(grown, by_addr, num * sizeof(chunk *));
+        ::operator delete(by_addr);
+        by_addr = grown;
+      }
+      chunk **at = std::upper_bound(by_addr, by_addr + num, c);
+      memmove(at + 1, at, (by_addr + num - at) * sizeof(chunk *));
+      *at = c;
+      num++;
+    }
+  };
+
+  static arena &local() {
+    static thread_local arena a; // zero-initialized
+    return a;
+  }
+
+  // frees the chunks of the thread's arena when the thread exits; the
+  // arena is left empty, so that blocks freed later go to P
+  struct releaser {
+    ~releaser() {
+      arena &a = local();
+      for (chunk *c = a.first; c;) {
+        chunk *next = c->next;
+        ::operator delete(c);
+        c = next;
+      }
+      ::operator delete(a.by_addr);
+      a = arena();
+    }
+  };
+
+  // moves on to the next chunk that can hold sz bytes, adding one if needed
+  static void next_chunk(arena &a, const size_t &sz) {
+    chunk *prev = a.in_use;
+    chunk *c = prev ? prev->next : a.first;
+    while (c && c->size < sz) {
+      prev = c;
+      c = c->next;
+    }
+    if (!c) {
+      static thread_local releaser r; // created with the first chunk
+      (void)r;
+      size_t size = sz > CHUNK ? sz : CHUNK;
+      c = static_cast<chunk *>(::operator new(HEADER + size));
+      c->size = size;
+      c->next = 0;
+      if (prev)
+        prev->next = c;
+      else
+        a.first = c;
+      a.add(c);
+    }
+    a.in_use = c;
+    a.cur = c->data();
+    a.end = a.cur + c->size;
+  }
+};
+
+/**
+ * \brief Standard allocator over a policy; allocate(n) takes n objects of T.
+ */
+template <typename T, class POLICY> struct policy_allocator {
+  typedef T value_type;
+
+  template <typename U> struct rebind {
+    typedef policy_allocator<U, POLICY> other;
+  };
+
+  policy_allocator() {}
+  template <typename U>
+  policy_allocator(const policy_allocator<U, POLICY> &) {}
+
+  T *allocate(const size_t &n) {
+    return static_cast<T *>(POLICY::allocate(n * sizeof(T)));
+  }
+  void deallocate(T *p, const size_t &n) {
+    POLICY::deallocate(p, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const policy_allocator<U, POLICY> &) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const policy_allocator<U, POLICY> &) const {
+    return false;
+  }
+};
+
+// the policy of ALLOC; build with -DALLOC_POLICY=heap_policy for the system
+// heap
+#ifndef ALLOC_POLICY
+#define ALLOC_POLICY pool_policy
+#endif
+
+typedef walk_policy<ALLOC_POLICY> WALK_POLICY;
+
+/** Allocator of the objects that may outlive a walk (VATs, level-one
+ * patterns, adjacency lists) */
+template <typename T> using ALLOC = policy_allocator<T, ALLOC_POLICY>;
+
+/** Allocator of the objects of a walk (candidate patterns), see walk_scope */
+template <typename T> using WALK_ALLOC = policy_allocator<T, WALK_POLICY>;
+
+/**
+ * Memory for operator new of a class allocated with A, an ALLOC or
+ * WALK_ALLOC: size is in bytes, where A::allocate() counts objects.
+ */
+template <template <typename> class A> inline void *alloc_bytes(size_t size) {
+  return A<char>().allocate(size);
+}
+
+template <template <typename> class A>
+inline void free_bytes(void *p, size_t size) {
+  if (p)
+    A<char>().deallocate(static_cast<char *>(p), size);
+}
+
+/**
+ * \brief Marks the lifetime of one walk on this thread (RAII): the
+ * WALK_ALLOC allocations made meanwhile are all released when it ends.
+ */
+class walk_scope {
+public:
+  walk_scope() { WALK_POLICY::begin_walk(); }
+  ~walk_scope() { WALK_POLICY::end_walk(); }
+
+private:
+  walk_scope(const walk_scope &) = delete;
+  walk_scope &operator=(const walk_scope &) = delete;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _BUMP_ARENA_H
+#define _BUMP_ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/**
+ * \brief Bump allocator for trivially copyable elements of type T.
+ *
+ * Memory is handed out from chunks that grow geometrically, starting small so
+ * that the many short-lived owners (e.g. candidate VATs) stay cheap. Single
+ * allocations are never freed; everything goes away with the arena. The most
+ * recent allocation may be grown with extend(), which is done in place when
+ * the current chunk has room for it.
+ */
+template <typename T> class bump_arena {
+public:
+  bump_arena(const size_t &first_chunk = 256, const size_t &max_chunk = 1 << 20)
+      : _next_chunk(first_chunk ? first_chunk : 1), _max_chunk(max_chunk),
+        _cur(0), _used(0), _cap(0), _last(0) {}
+
+  bump_arena(const bump_arena &) = delete;
+  bump_arena &operator=(const bump_arena &) = delete;
+
+  /** Returns room for n elements, contiguous */
+  T *allocate(const size_t &n) {
+    if (_used + n > _cap)
+      new_chunk(n);
+    _last = _cur + _used;
+    _used += n;
+    return _last;
+  }
+
+  /**
+   * Grows p, the last allocation made, from old_n to new_n elements and
+   * returns its (possibly new) address; the first old_n elements are kept.
+   */
+  T *extend(T *p, const size_t &old_n, const size_t &new_n) {
+    if (p == _last && (p - _cur) + new_n <= _cap) {
+      _used = (p - _cur) + new_n;
+      return p;
+    }
+    T *np = allocate(new_n);
+    if (old_n)
+      memcpy(np, p, old_n * sizeof(T));
+    return np;
+  }
+
+  /** Takes over all memory of other, which is left empty; allocations made
+   * from other stay valid */
+  void adopt(bump_arena &other) {
+    for (unsigned int i = 0; i < other._chunks.size(); i++) {
+      _chunks.push_back(std::move(other._chunks[i]));
+      _sizes.push_back(other._sizes[i]);
+    }
+    other._chunks.clear();
+    other._sizes.clear();
+    other._cur = other._last = 0;
+    other._used = other._cap = 0;
+  }
+
+  /** Total number of elements reserved from the heap */
+  size_t capacity() const {
+    size_t sz = 0;
+    for (unsigned int i = 0; i < _sizes.size(); i++)
+      sz += _sizes[i];
+    return sz;
+  }
+
+private:
+  void new_chunk(const size_t &n) {
+    size_t sz = _next_chunk;
+    while (sz < n)
+      sz *= 2;
+    _chunks.push_back(std::unique_ptr<T[]>(new T[sz]));
+    _sizes.push_back(sz);
+    _cur = _chunks.back().get();
+    _used = 0;
+    _cap = sz;
+    if (_next_chunk < _max_chunk)
+      _next_chunk *= 2;
+  }
+
+  std::vector<std::unique_ptr<T[]>> _chunks;
+  std::vector<size_t> _sizes;
+  size_t _next_chunk; // size of the next chunk
+  size_t _max_chunk;  // chunks stop doubling at this size
+  T *_cur;            // current chunk
+  size_t _used;       // elements used in the current chunk
+  size_t _cap;        // size of the current chunk
+  T *_last;           // last allocation, the only one extend() grows in place
+
+}; // end class bump_arena
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef CONC_STORAGE_MANAGER_H_
+#define CONC_STORAGE_MANAGER_H_
+
+#include "generic_classes.h"
+#include "hash_utils.hpp"
+#include "helper_funs.h"
+#include "pat_fam.h"
+#include "pat_support.h"
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \brief Storage Manager class partially specialized to a Memory-based Storage
+ * manager that may be used by several mining threads at once.
+ *
+ * The pattern-to-VAT map is split into shards, picked by hashing the pattern
+ * id, and each shard has its own reader/writer lock. VATs are held through
+ * reference-counted handles: delete_vat() only drops the map's reference, so
+ * a VAT that another thread is intersecting stays alive until that thread is
+ * done with it. Unlike memory_storage, the VATs still stored are reclaimed
+ * when the last copy of the storage manager goes away.
+ *
+ * Copies of this storage manager share the same shards, hence each mining
+ * thread can build its own count_support from one storage manager.
+ */
+template <class PAT, class VAT>
+class storage_manager<PAT, VAT, concurrent_memory_storage> {
+
+  typedef typename PAT::CC_STORAGE_TYPE C_ST;
+  typedef typename PAT::CC_COMPARISON_FUNC C_CF;
+
+public:
+  typedef std::shared_ptr<VAT> VAT_HANDLE;
+  typedef std::unordered_map<C_ST, VAT_HANDLE, myhash<C_ST>, C_CF>
+      CC_ST_TO_VATPTR;
+  typedef typename CC_ST_TO_VATPTR::const_iterator CONST_IT;
+  typedef typename CC_ST_TO_VATPTR::iterator IT;
+  typedef pattern_support<typename PAT::MINE_PROPS> PAT_SUP;
+
+  storage_manager(const unsigned int &num_shards = 64)
+      : _shards(std::make_shared<vector<shard>>(num_shards ? num_shards : 1)) {
+  }
+
+  storage_manager(pat_fam<PAT> &freq_one_pats, vector<VAT *> &freq_one_vats)
+      : storage_manager() {
+
+    typename pat_fam<PAT>::CONST_IT cit = freq_one_pats.begin();
+    int idx = 0;
+
+    while (cit != freq_one_pats.end()) {
+      add_vat(*cit, freq_one_vats[idx++]);
+      cit++;
+    }
+  }
+
+  /**
+   * Return true if the pattern is found in the storage manager.
+   */
+  bool find(PAT *const &p) const { return get_vat_handle(p) != 0; }
+
+  /**
+   * Return a handle to the vat corresponding to the pattern; the vat stays
+   * valid for as long as the handle is held, even if it is deleted meanwhile.
+   */
+  VAT_HANDLE get_vat_handle(PAT *const &p) const {
+    const shard &s = get_shard(p->pat_id());
+    std::shared_lock<std::shared_mutex> guard(s.lock);
+    CONST_IT hmap_it = s.pat_to_vat.find(p->pat_id());
+    if (hmap_it != s.pat_to_vat.end())
+      return hmap_it->second;
+    return VAT_HANDLE();
+  }
+
+  /**
+   * Return the vat corresponding to the pattern. The pointer is only safe to
+   * use while no other thread may delete this pattern's vat.
+   */
+  VAT *get_vat(PAT *const &p) const { return get_vat_handle(p).get(); }
+
+  /**
+   * Delete the vat; the memory is reclaimed once the last handle is released.
+   */
+  void delete_vat(PAT *const &p) {
+    VAT_HANDLE vat; // released outside of the lock
+    {
+      shard &s = get_shard(p->pat_id());
+      std::unique_lock<std::shared_mutex> guard(s.lock);
+      IT hmap_it = s.pat_to_vat.find(p->pat_id());
+      if (hmap_it != s.pat_to_vat.end()) {
+        vat.swap(hmap_it->second);
+        s.pat_to_vat.erase(hmap_it); // erases pat-vat mapping from hashmap
+      }
+    }
+    if (!vat)
+      std::cout << "storage_manager.delete_vat:vat not found for "
+                << p->pat_id() << endl;
+  }
+
+  /**
+   * Map the pattern to the VAT; the storage manager takes ownership of v.
+   */
+  bool add_vat(PAT *const &p, VAT *v) {
+    shard &s = get_shard(p->pat_id());
+    std::unique_lock<std::shared_mutex> guard(s.lock);
+    if (s.pat_to_vat.find(p->pat_id()) != s.pat_to_vat.end())
+      return false; // v stays with the caller, as for memory_storage
+    s.pat_to_vat.insert(make_pair(p->pat_id(), VAT_HANDLE(v)));
+    return true;
+  }
+
+  /**
+   * Map the pattern to a VAT that others may hold too (see vat_cache.h).
+   */
+  bool add_vat_handle(PAT *const &p, const VAT_HANDLE &h) {
+    shard &s = get_shard(p->pat_id());
+    std::unique_lock<std::shared_mutex> guard(s.lock);
+    return s.pat_to_vat.insert(make_pair(p->pat_id(), h)).second;
+  }
+
+  /**
+   *
+   */
+  void print_tids(PAT *const &p) {
+    VAT_HANDLE h = get_vat_handle(p);
+    if (h) {
+      h->print_tids();
+    } else {
+      cout << "print_tids(): vat not found" << endl;
+    }
+  }
+
+  /**
+   *
+   */
+  void get_tids(PAT *const &p, vector<unsigned int> &tids) {
+    VAT_HANDLE h = get_vat_handle(p);
+    if (h) {
+      h->get_tids(tids);
+    } else {
+      cout << "print_tids(): vat not found" << endl;
+    }
+  }
+
+  /**
+   * Generate candidate VATs for the next level, from the provided patterns.
+   * Both input VATs are pinned for the duration of the intersection.
+   */
+  VAT **intersect(PAT *const &p1, PAT *const &p2, PAT_SUP **cand_sups,
+                  PAT **cand_pats, const bool &isfwd, const pair<int, int> &ids,
+                  const int &minsup) {
+
+    VAT_HANDLE v1 = get_vat_handle(p1);
+    if (!v1) {
+      cout << "storage_manager: vat not found for pattern = " << p1->pat_id()
+           << endl;
+      return 0;
+    }
+
+    VAT_HANDLE v2 = get_vat_handle(p2);
+    if (!v2) {
+      cout << "storage_manager: vat not found for pattern = " << p2->pat_id()
+           << endl;
+      return 0;
+    }
+
+    return VAT::intersection(v1.get(), v2.get(), cand_sups, cand_pats, isfwd,
+                             ids, minsup);
+  }
+
+  /**
+   * Batched intersect(): candidate i adds the edge p2 from vertex src of p1
+   * to its vertex dests[i], or to a new vertex when dests[i] is p1's size.
+   */
+  VAT **intersect(PAT *const &p1, PAT *const &p2, PAT_SUP **cand_sups,
+                  PAT **cand_pats, const int &num, const int &src,
+                  const int *dests, const int &minsup) {
+    VAT_HANDLE v1 = get_vat_handle(p1), v2 = get_vat_handle(p2);
+    if (!v1 || !v2) {
+      cout << "storage_manager: vat not found for pattern = "
+           << (v1 ? p2 : p1)->pat_id() << endl;
+      return 0;
+    }
+    return VAT::intersection(v1.get(), v2.get(), cand_sups, cand_pats, num,
+                             src, dests, minsup);
+  }
+
+  void print() const {
+    for (unsigned int i = 0; i < _shards->size(); i++) {
+      const shard &s = (*_shards)[i];
+      std::shared_lock<std::shared_mutex> guard(s.lock);
+      CONST_IT hmap_it;
+      for (hmap_it = s.pat_to_vat.begin(); hmap_it != s.pat_to_vat.end();
+           hmap_it++)
+        cout << hmap_it->first << "->" << hmap_it->second.get() << endl;
+    }
+  } // end print()
+
+  void print_pat_ids() const {
+    for (unsigned int i = 0; i < _shards->size(); i++) {
+      const shard &s = (*_shards)[i];
+      std::shared_lock<std::shared_mutex> guard(s.lock);
+      CONST_IT hmap_it;
+      for (hmap_it = s.pat_to_vat.begin(); hmap_it != s.pat_to_vat.end();
+           hmap_it++)
+        cout << hmap_it->first << " ";
+    }
+    cout << endl;
+  }
+
+  unsigned int size() const {
+    unsigned int sz = 0;
+    for (unsigned int i = 0; i < _shards->size(); i++) {
+      const shard &s = (*_shards)[i];
+      std::shared_lock<std::shared_mutex> guard(s.lock);
+      sz += s.pat_to_vat.size();
+    }
+    return sz;
+  }
+
+private:
+  struct shard {
+    mutable std::shared_mutex lock;
+    CC_ST_TO_VATPTR pat_to_vat;
+  };
+
+  shard &get_shard(const C_ST &id) {
+    return (*_shards)[myhash<C_ST>()(id) % _shards->size()];
+  }
+
+  const shard &get_shard(const C_ST &id) const {
+    return (*_shards)[myhash<C_ST>()(id) % _shards->size()];
+  }
+
+  std::shared_ptr<vector<shard>> _shards; // shared by all copies
+};
+
+#endif
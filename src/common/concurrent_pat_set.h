@@ -0,0 +1,125 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _CONCURRENT_PAT_SET_H
+#define _CONCURRENT_PAT_SET_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Sharded multiset of canonical codes, shared by all walker threads.
+ *
+ * Each code is counted the number of times it was reported. The key space is
+ * split over a fixed number of shards, each a hash table guarded by its own
+ * mutex, so that threads finishing walks at the same time rarely wait on each
+ * other. KEY is usually a code_key (see graph_code_key.h).
+ *
+ * The set also keeps the number of keys recorded exactly once and exactly
+ * twice, and of all occurrences, which is what the estimates of the keys
+ * not seen yet rest on (see stop_policy).
+ */
+template <typename KEY = std::string, typename HASH = std::hash<KEY>>
+class concurrent_pat_set {
+public:
+  typedef std::unordered_map<KEY, int, HASH> SHARD_MAP;
+  typedef typename SHARD_MAP::const_iterator CONST_IT;
+
+  concurrent_pat_set(const unsigned int &num_shards = 64)
+      : _shards(num_shards ? num_shards : 1), _once(0), _twice(0),
+        _occurrences(0) {}
+
+  /** Records one more occurrence of key; returns the new count, so a return
+   * value of 1 means this is the first time key has been seen */
+  int insert(const KEY &key) {
+    shard &s = get_shard(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    int c = ++(s.counts[key]);
+    _occurrences++;
+    if (c == 1) {
+      _once++;
+    } else if (c == 2) {
+      _once--;
+      _twice++;
+    } else if (c == 3) {
+      _twice--;
+    }
+    return c;
+  }
+
+  /** Keys recorded exactly once */
+  unsigned long singletons() const { return _once; }
+
+  /** Keys recorded exactly twice */
+  unsigned long doubletons() const { return _twice; }
+
+  /** All occurrences recorded, of all keys */
+  unsigned long occurrences() const { return _occurrences; }
+
+  /** Returns the number of times key was recorded, 0 if never */
+  int count(const KEY &key) const {
+    const shard &s = get_shard(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    CONST_IT it = s.counts.find(key);
+    return (it == s.counts.end()) ? 0 : it->second;
+  }
+
+  /** Number of distinct keys; not synchronized with concurrent inserts */
+  unsigned int size() const {
+    unsigned int sz = 0;
+    for (unsigned int i = 0; i < _shards.size(); i++) {
+      std::lock_guard<std::mutex> guard(_shards[i].lock);
+      sz += _shards[i].counts.size();
+    }
+    return sz;
+  }
+
+  /** Copies the contents into one ordered map, e.g. for printing once the
+   * walkers have finished */
+  void merge_into(std::map<KEY, int> &out) const {
+    for (unsigned int i = 0; i < _shards.size(); i++) {
+      std::lock_guard<std::mutex> guard(_shards[i].lock);
+      out.insert(_shards[i].counts.begin(), _shards[i].counts.end());
+    }
+  }
+
+private:
+  struct shard {
+    mutable std::mutex lock;
+    SHARD_MAP counts;
+  };
+
+  shard &get_shard(const KEY &key) {
+    return _shards[HASH()(key) % _shards.size()];
+  }
+
+  const shard &get_shard(const KEY &key) const {
+    return _shards[HASH()(key) % _shards.size()];
+  }
+
+  std::vector<shard> _shards;
+  std::atomic<unsigned long> _once, _twice, _occurrences;
+
+}; // end class concurrent_pat_set
+
+#endif
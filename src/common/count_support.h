@@ -21,20 +21,35 @@
 #define _COUNT_SUPPORT_H_
 
 #include "adj_list.h"
+#include "alloc_policy.h"
+#include "conc_storage_manager.h"
 #include "generic_classes.h"
 #include "mem_storage_manager.h"
+#include "metrics.h"
 #include "pattern.h"
+#include "vat_cache.h"
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <type_traits>
 
-template <typename T> using ALLOC = std::allocator<T>;
 /**
  * \brief count_support class partially specialized for vertical mining.
  *
+ * VAT_ST is the storage type of the VATs, std::vector unless given.
+ *
+ * count_batch() counts all candidates that add the same edge at the same
+ * vertex, going over the parent's VAT once.
+ *
+ * With concurrent_memory_storage, a vat_cache may be attached (set_cache()):
+ * the VATs of frequent candidates then go to the cache as well, keyed by the
+ * candidate's canonical code, and a candidate found there is not counted.
  */
 template <class PP, class JOIN_TYPE, class TRANS, class ST,
-          template <class, typename, typename> class CC, class SM_TYPE>
+          template <class, typename, typename> class CC, class SM_TYPE,
+          template <typename, typename> class VAT_ST>
 class count_support<PP, proplist<JOIN_TYPE, proplist<vert_mine, TRANS>>, ST, CC,
-                    SM_TYPE> {
+                    SM_TYPE, VAT_ST> {
 
 public:
   typedef proplist<JOIN_TYPE, proplist<vert_mine, TRANS>> MINING_PROPS;
@@ -42,11 +57,18 @@ public:
   typedef PP PATTERN_PROPS;
   // typedef SM_TYPE STORAGE_MANAGER_TYPE;
   typedef pattern<PATTERN_PROPS, MINING_PROPS, PAT_ST_TYPE, CC> PATTERN;
-  typedef vat<PATTERN_PROPS, MINING_PROPS, std::vector> VAT;
+  typedef vat<PATTERN_PROPS, MINING_PROPS, VAT_ST> VAT;
   typedef pattern_support<MINING_PROPS> PAT_SUP;
+  typedef decltype(std::declval<const typename PATTERN::CAN_CODE &>().key())
+      CACHE_KEY;
+  typedef vat_cache<CACHE_KEY, VAT, PAT_SUP, myhash<CACHE_KEY>> VAT_CACHE;
 
   count_support(storage_manager<PATTERN, VAT, SM_TYPE> const &sm)
-      : _strg_mgr(sm) {}
+      : _strg_mgr(sm), _cache(0) {}
+
+  /** Shares VATs with other walks through cache; only used with
+   * concurrent_memory_storage */
+  void set_cache(VAT_CACHE *cache) { _cache = cache; }
 
   // function to count support of candidate patterns
   // cand_supports is populated, num is # of candidates generated
@@ -54,23 +76,26 @@ public:
              const int &minsup, const int &num, const bool &isfwd,
              const pair<int, int> &ids) {
 
+    if constexpr (std::is_same<SM_TYPE, concurrent_memory_storage>::value) {
+      if (_cache && num == 1 && cand_pats[0]) {
+        cached_count(p1, p2, cand_pats, minsup, 1, ids.first, &ids.second);
+        return;
+      }
+    }
+
     // invoke storage_mgr's intersect to get VATs and support for candidates
     VAT **cand_vats; // pointer to VAT ptrs for candidates
-    PAT_SUP **cand_sups = new PAT_SUP *[num];
-
+    PAT_SUP **cand_sups = candidate_sups(cand_pats, num);
     int i;
-    for (i = 0; i < num; i++)
-      if (cand_pats[i])
-        cand_sups[i] = new PAT_SUP;
-      else
-        cand_sups[i] = 0;
 
     // bool is_l2=(p1->size()==1);
 
     // intersect() is expected to populate the support member
     // of each cand_pat
+    metric_timer t(isfwd ? metrics::ISECT_FWD : metrics::ISECT_BACK);
     cand_vats =
         _strg_mgr.intersect(p1, p2, cand_sups, cand_pats, isfwd, ids, minsup);
+    t.stop();
 
     // check which candidates were frequent
     // and add their VATs to strg_mgr
@@ -90,15 +115,57 @@ public:
         if (cand_vats != NULL)
           delete cand_vats[i];
       }
-      delete cand_sups[i];
     } // end for
 
-    delete[] cand_sups;
     if (cand_vats != NULL)
       delete[] cand_vats;
 
   } // end count()
 
+  /**
+   * Counts the num candidates cand_pats, which add the edge p2 at vertex src
+   * of p1: candidate i leads to vertex dests[i] of p1, or to a new vertex
+   * when dests[i] is p1->size(). Null candidates are skipped, and nothing
+   * is done when all are null. Every candidate gets its support and the
+   * frequent ones their VATs; p1's VAT is deleted if any is frequent, as in
+   * count().
+   */
+  void count_batch(PATTERN *const &p1, PATTERN *const &p2,
+                   PATTERN **const &cand_pats, const int &minsup,
+                   const int &num, const int &src, const int *dests) {
+    if (std::count(cand_pats, cand_pats + num, (PATTERN *)0) == num)
+      return;
+    if constexpr (std::is_same<SM_TYPE, concurrent_memory_storage>::value) {
+      if (_cache) {
+        cached_count(p1, p2, cand_pats, minsup, num, src, dests);
+        return;
+      }
+    }
+
+    PAT_SUP **cand_sups = candidate_sups(cand_pats, num);
+    metric_timer t(batch_timer(p1, cand_pats, num, dests));
+    VAT **cand_vats = _strg_mgr.intersect(p1, p2, cand_sups, cand_pats, num,
+                                          src, dests, minsup);
+    t.stop();
+
+    bool any_frequent = false;
+    for (int i = 0; i < num; i++) {
+      if (!cand_pats[i])
+        continue;
+      cand_pats[i]->set_support(cand_sups[i]);
+      if (cand_sups[i]->is_valid(minsup)) {
+        _strg_mgr.add_vat(cand_pats[i], cand_vats[i]);
+        any_frequent = true;
+      } else if (cand_vats != NULL) {
+        delete cand_vats[i];
+      }
+    }
+    delete[] cand_vats;
+
+    if (any_frequent && p1->size() > 2) // Cannot delete single edges.
+      _strg_mgr.delete_vat(p1);
+  } // end count_batch()
+
   void delete_vat(PATTERN *const &p) { _strg_mgr.delete_vat(p); }
 
   VAT *get_vat(PATTERN *const &p) { return _strg_mgr.get_vat(p); }
@@ -115,7 +182,106 @@ public:
   storage_manager<PATTERN, VAT, SM_TYPE> &get_sm_ref() { return _strg_mgr; }
 
 private:
+  /** Fresh supports for the num candidates, null for the null ones; the
+   * storage is kept from call to call, so a walk step allocates none */
+  PAT_SUP **candidate_sups(PATTERN **const &cand_pats, const int &num) {
+    if (_sups.size() < (unsigned int)num) {
+      _sups.resize(num);
+      _sup_ptrs.resize(num);
+    }
+    for (int i = 0; i < num; i++) {
+      _sups[i] = PAT_SUP();
+      _sup_ptrs[i] = cand_pats[i] ? &_sups[i] : 0;
+    }
+    return _sup_ptrs.data();
+  }
+
+  /** The timer of a batch: ISECT_FWD or ISECT_BACK if all its candidates
+   * add a forward or a back edge, ISECT_BATCH if they are mixed */
+  static metrics::id batch_timer(PATTERN *const &p1,
+                                 PATTERN **const &cand_pats, const int &num,
+                                 const int *dests) {
+    if (!metrics::on())
+      return metrics::ISECT_BATCH;
+    bool fwd = false, back = false;
+    for (int i = 0; i < num; i++)
+      if (cand_pats[i])
+        (dests[i] == (int)p1->size() ? fwd : back) = true;
+    return fwd && back ? metrics::ISECT_BATCH
+                       : (fwd ? metrics::ISECT_FWD : metrics::ISECT_BACK);
+  }
+
+  /** count_batch() looking the VATs of the candidates up in the cache
+   * first; only the others are intersected. Like candidate_sups(), it
+   * keeps its buffers from call to call. */
+  void cached_count(PATTERN *const &p1, PATTERN *const &p2,
+                    PATTERN **const &cand_pats, const int &minsup,
+                    const int &num, const int &src, const int *dests) {
+    PAT_SUP **cand_sups = candidate_sups(cand_pats, num);
+    if (_keys.size() < (unsigned int)num) {
+      _keys.resize(num);
+      _handles.resize(num);
+      _missed.resize(num);
+    }
+    int num_missed = 0;
+    for (int i = 0; i < num; i++) {
+      _missed[i] = 0;
+      if (!cand_pats[i])
+        continue;
+      _keys[i] = cand_pats[i]->key();
+      if (!_cache->get(_keys[i], _handles[i], _sups[i])) {
+        _missed[i] = cand_pats[i];
+        num_missed++;
+      }
+    }
+    metrics::add(metrics::VAT_CACHE_MISS, num_missed);
+    metrics::add(metrics::VAT_CACHE_HIT,
+                 num - num_missed -
+                     std::count(cand_pats, cand_pats + num, (PATTERN *)0));
+
+    if (num_missed) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      metric_timer t(batch_timer(p1, _missed.data(), num, dests));
+      VAT **cand_vats = _strg_mgr.intersect(p1, p2, cand_sups, _missed.data(),
+                                            num, src, dests, minsup);
+      t.stop();
+      // the cost of a batch is shared evenly by its candidates
+      std::chrono::duration<double> cost =
+          (std::chrono::steady_clock::now() - start) / num_missed;
+      for (int i = 0; cand_vats && i < num; i++) {
+        if (!_missed[i])
+          continue;
+        _handles[i].reset(cand_vats[i]);
+        if (_sups[i].is_valid(minsup))
+          _cache->put(_keys[i], _handles[i], _sups[i], cost.count());
+      }
+      delete[] cand_vats;
+    }
+
+    bool any_frequent = false;
+    for (int i = 0; i < num; i++) {
+      if (!cand_pats[i])
+        continue;
+      cand_pats[i]->set_support(&_sups[i]);
+      if (_sups[i].is_valid(minsup)) {
+        _strg_mgr.add_vat_handle(cand_pats[i], _handles[i]);
+        any_frequent = true;
+      }
+      _handles[i].reset(); // the buffer must not keep the VAT alive
+    }
+    if (any_frequent && p1->size() > 2) // Cannot delete single edges.
+      _strg_mgr.delete_vat(p1);
+  }
+
   storage_manager<PATTERN, VAT, SM_TYPE> _strg_mgr;
+  VAT_CACHE *_cache;
+  vector<PAT_SUP> _sups;       // supports of the candidates being counted
+  vector<PAT_SUP *> _sup_ptrs; // and pointers to them, see candidate_sups()
+  // buffers of cached_count(): keys, VATs and the candidates not cached
+  vector<CACHE_KEY> _keys;
+  vector<typename VAT_CACHE::VAT_HANDLE> _handles;
+  vector<PATTERN *> _missed;
 
 }; // end class count_support()
 
@@ -22,10 +22,12 @@
 #ifndef _DB_READER_H
 #define _DB_READER_H
 
+#include <cstring>
 #include <fstream>
 #include <map>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 // using namespace std;
@@ -34,12 +36,16 @@
 
 #include "generic_classes.h"
 #include "helper_funs.h"
+#include "mapped_file.h"
+#include "mem_storage_manager.h"
+#include "metrics.h"
 #include "pat_fam.h" // added later to make .cpp files
 /**
  * \brief Database Reader class, to read the input file.
  *
  * This class reads the database, using the tokenizer class and populate the
- * level-1 VAT.
+ * level-1 VAT. A database in the tokenizer's binary format, recognized by its
+ * first bytes, is memory-mapped and handed to the tokenizer as a whole.
  */
 template <typename PATTERN, typename TOKENIZER> class db_reader {
 public:
@@ -53,23 +59,30 @@ public:
                    typename PATTERN::EDGE_T>,
               int>
       FREQ_MAP;
+  typedef typename TKNZ::TRANS_DB TRANS_DB; /// transaction store of the
+                                             /// tokenizer, see keep_trans()
 
   /** \fn db_reader(const char* infile_name)
    * \brief Constructor
    * \param infile_name Name of the input database (flat) file
    */
   db_reader(const char *infile_name)
-      : _in_db(infile_name), filename(std::string(infile_name)) {}
+      : _in_db(infile_name), filename(std::string(infile_name)),
+        _trans_db(0) {
+    open_binary(infile_name);
+  }
 
   /** \fn db_reader(const char* infile_name, int mem_size)
    * \brief Constructor_for_gigabase
    * \param infile_name Name of the input database (flat) file.
    * \param mem_size Maximum size of memory vat for gigabase backend.
    */
-  db_reader(const char *infile_name, int mem_size) : _in_db(infile_name) {
+  db_reader(const char *infile_name, int mem_size)
+      : _in_db(infile_name), _trans_db(0) {
     filename = std::string(infile_name);
     std::cout << "Filename: " << filename << std::endl;
     _max_mem = mem_size;
+    open_binary(infile_name);
   }
 
   /** \fn ~db_reader()
@@ -84,34 +97,51 @@ public:
    */
   void open(const char *infile_name) {
     if (is_open())
-      _in_db.close();
+      close();
     _in_db.open(infile_name);
+    filename = std::string(infile_name);
+    open_binary(infile_name);
   }
 
   /** void close()
    * \brief Closes the file associated with this class
    */
-  void close() { _in_db.close(); }
+  void close() {
+    _in_db.close();
+    _in_map.close();
+  }
 
   /** bool is_open
    * \brief returns whether file associated with this object is open
    */
-  bool is_open() { return _in_db.is_open(); }
+  bool is_open() { return _in_db.is_open() || _in_map.is_open(); }
+
+  /** bool is_binary()
+   * \brief returns whether the file is read through a memory mapping
+   */
+  bool is_binary() { return _in_map.is_open(); }
+
+  /** void keep_trans(TRANS_DB* db)
+   * \brief has get_length_one() also keep the transactions it reads in db,
+   * in input order; 0 turns this off
+   */
+  void keep_trans(TRANS_DB *db) { _trans_db = db; }
 
   /** void get_length_one(pat_fam<PATTERN>& freq_pats, vat_db<PATTERN, VAT,0>&
    * vat_hmap, int minsup) \brief obtain length one frequent patterns in sorted
    * order, and populate vat_db with their vats \param freq_pats Pattern Family
    * which is populated with the frequent patterns \param vat_hmap The hashmap
    * used to store pattern-to-VAT mappings \param minsup Minimum support
-   * threshold
+   * threshold \param num_threads Number of threads reading the database
    */
-  template <class SM_T>
+  template <class SM_T, class VAT_T>
   void get_length_one(pat_fam<PATTERN> &freq_pats,
-                      storage_manager<PATTERN, VAT, SM_T> &vat_hmap,
-                      const int &minsup, FREQ_MAP &fm) {
+                      storage_manager<PATTERN, VAT_T, SM_T> &vat_hmap,
+                      const int &minsup, FREQ_MAP &fm,
+                      const unsigned int &num_threads = 1) {
 
     int tid;
-    VAT *ivat;
+    VAT_T *ivat;
     typename pat_fam<PATTERN>::IT pf_it;
 
     if (!is_open()) {
@@ -121,16 +151,36 @@ public:
       return;
     }
 
-    tid = tknz.parse_next_trans(_in_db, freq_pats, vat_hmap, fm);
+    // labels kept in a dictionary are added before any of them is parsed
+    if (!is_binary() && TKNZ::keeps_dict())
+      add_ascii_labels();
+
     int i = 0; // i keep track of total transaction read
-    while (tid != -1) {
-      // cout << "Read " << i << " transaction\n";
-      i++;
+    tknz.keep_trans(_trans_db);
+    metric_timer tt_read(metrics::TOKENIZE);
+    if (num_threads > 1) {
+      i = read_parallel(freq_pats, vat_hmap, fm, num_threads);
+    } else if (is_binary()) {
+      unsigned int next = 0; // index of the next transaction to read
+      typename TKNZ::template BIN_VATS<VAT_T> l1_vats;
+      tid = tknz.parse_next_trans(next, freq_pats, vat_hmap, fm, l1_vats);
+      while (tid != -1) {
+        i++;
+        tid = tknz.parse_next_trans(next, freq_pats, vat_hmap, fm, l1_vats);
+      }
+    } else {
       tid = tknz.parse_next_trans(_in_db, freq_pats, vat_hmap, fm);
+      while (tid != -1) {
+        // cout << "Read " << i << " transaction\n";
+        i++;
+        tid = tknz.parse_next_trans(_in_db, freq_pats, vat_hmap, fm);
+      }
     }
     _trans_cnt = i;
+    tt_read.stop();
 
     // fill in support of level-1, discarding infrequent ones
+    metric_timer tt_level_one(metrics::LEVEL_ONE);
     for (pf_it = freq_pats.begin(); pf_it != freq_pats.end(); ++pf_it) {
       if (!(ivat = vat_hmap.get_vat(*pf_it))) {
         std::cerr << "db_reader.get_length_one: VAT not found for " << *pf_it
@@ -140,9 +190,10 @@ public:
 
       // cout << "LEVEL 1 " << *ivat << endl;
 
-      if ((ivat->size()) >= minsup)
+      if ((ivat->size()) >= minsup) {
         (*pf_it)->set_sup(make_pair(ivat->size(), 0));
-      else {
+        ivat->finish();
+      } else {
         // Delete the pattern and the vat.
         vat_hmap.delete_vat(*pf_it);
         delete (*pf_it);
@@ -169,11 +220,173 @@ public:
   unsigned int get_transaction_count() const { return _trans_cnt; }
 
 private:
+  /** Patterns, VATs and edge frequencies read by one thread */
+  template <class VAT_T> struct db_part {
+    pat_fam<PATTERN> pats;
+    storage_manager<PATTERN, VAT_T, memory_storage> vats;
+    FREQ_MAP fm;
+    TRANS_DB trans;
+    int trans_cnt;
+  };
+
+  /**
+   * Reads the database on num_threads threads, each building the level-one
+   * patterns and VATs of a contiguous range of transactions. The parts are
+   * then merged in input order, so that freq_pats, the VATs and fm are the
+   * same as when read by a single thread. Returns the number of transactions.
+   */
+  template <class SM_T, class VAT_T>
+  int read_parallel(pat_fam<PATTERN> &freq_pats,
+                    storage_manager<PATTERN, VAT_T, SM_T> &vat_hmap,
+                    FREQ_MAP &fm, const unsigned int &num_threads) {
+    vector<db_part<VAT_T>> parts(num_threads);
+    vector<std::thread> pool;
+    mapped_file text; // ASCII input, shared by all threads
+
+    if (is_binary()) {
+      unsigned int n = tknz.num_binary_trans();
+      for (unsigned int t = 0; t < num_threads; t++) {
+        unsigned int b = (unsigned long)n * t / num_threads;
+        unsigned int e = (unsigned long)n * (t + 1) / num_threads;
+        pool.push_back(std::thread([this, b, e, &parts, t]() {
+          TKNZ part_tknz;
+          db_part<VAT_T> &part = parts[t];
+          part.trans_cnt = 0;
+          if (_trans_db)
+            part_tknz.keep_trans(&part.trans);
+          if (!part_tknz.open_binary(_in_map))
+            return;
+          typename TKNZ::template BIN_VATS<VAT_T> l1_vats;
+          for (unsigned int next = b; next < e; part.trans_cnt++)
+            if (part_tknz.parse_next_trans(next, part.pats, part.vats,
+                                           part.fm, l1_vats) == -1)
+              break;
+        }));
+      }
+    } else {
+      if (!text.open(filename.c_str())) {
+        std::cerr << "db_reader: cannot map " << filename << std::endl;
+        return 0;
+      }
+      vector<const char *> bounds = split_ascii(text, num_threads);
+      for (unsigned int t = 0; t < num_threads; t++) {
+        const char *b = bounds[t], *e = bounds[t + 1];
+        pool.push_back(std::thread([this, b, e, &parts, t]() {
+          TKNZ part_tknz;
+          db_part<VAT_T> &part = parts[t];
+          part.trans_cnt = 0;
+          if (_trans_db)
+            part_tknz.keep_trans(&part.trans);
+          mem_istream in(b, e);
+          while (part_tknz.parse_next_trans(in, part.pats, part.vats,
+                                            part.fm) != -1)
+            part.trans_cnt++;
+        }));
+      }
+    }
+    for (unsigned int t = 0; t < pool.size(); t++)
+      pool[t].join();
+
+    // merge the parts in input order
+    int trans_cnt = 0;
+    for (unsigned int t = 0; t < num_threads; t++) {
+      db_part<VAT_T> &part = parts[t];
+      trans_cnt += part.trans_cnt;
+
+      typename pat_fam<PATTERN>::IT pf_it;
+      for (pf_it = part.pats.begin(); pf_it != part.pats.end(); ++pf_it) {
+        VAT_T *part_vat = part.vats.get_vat(*pf_it);
+        VAT_T *ivat = vat_hmap.get_vat(*pf_it);
+        if (!ivat) { // first seen in this part
+          vat_hmap.add_vat(*pf_it, part_vat);
+          freq_pats.push_back(*pf_it);
+        } else {
+          ivat->append(*part_vat);
+          delete part_vat;
+          delete (*pf_it);
+        }
+      }
+
+      if (_trans_db)
+        _trans_db->append(part.trans);
+
+      typename FREQ_MAP::const_iterator it;
+      for (it = part.fm.begin(); it != part.fm.end(); it++) {
+        typename FREQ_MAP::iterator git = fm.find(it->first);
+        if (git == fm.end())
+          fm.insert(git, *it);
+        else if (it->second > git->second)
+          git->second = it->second;
+      }
+    }
+    return trans_cnt;
+  }
+
+  /**
+   * Splits an ASCII database into n ranges that start at transaction ('t')
+   * lines, returned as n+1 boundaries. As in the serial reader, the database
+   * ends at the first empty line.
+   */
+  static vector<const char *> split_ascii(const mapped_file &text,
+                                          const unsigned int &n) {
+    const char *b = text.data(), *e = text.data() + text.size();
+    const char *p = b;
+    while (p < e) { // look for the first empty line
+      if (*p == '\n') {
+        e = p + 1;
+        break;
+      }
+      p = static_cast<const char *>(memchr(p, '\n', e - p));
+      if (!p)
+        break;
+      p++;
+    }
+
+    vector<const char *> bounds(1, b);
+    for (unsigned int t = 1; t < n; t++) {
+      p = std::max(bounds.back(), b + (e - b) * t / n);
+      // move on to the start of the next transaction
+      while (p < e && !(*p == 't' && (p == b || *(p - 1) == '\n'))) {
+        p = static_cast<const char *>(memchr(p, '\n', e - p));
+        p = p ? p + 1 : e;
+      }
+      bounds.push_back(p);
+    }
+    bounds.push_back(e);
+    return bounds;
+  }
+
+  /** Hands the labels of the ASCII database to the tokenizer */
+  void add_ascii_labels() {
+    mapped_file text;
+    if (!text.open(filename.c_str())) {
+      std::cerr << "db_reader: cannot map " << filename << std::endl;
+      return;
+    }
+    TKNZ::add_labels(text.data(), text.data() + text.size());
+  }
+
+  /** Maps the input file instead of streaming it, if it is a binary database
+   * the tokenizer can read */
+  void open_binary(const char *infile_name) {
+    if (!_in_map.open(infile_name))
+      return;
+    if (TKNZ::is_binary(_in_map) && tknz.open_binary(_in_map)) {
+      _in_db.close();
+    } else {
+      if (TKNZ::is_binary(_in_map)) // unusable binary file
+        _in_db.close();
+      _in_map.close();
+    }
+  }
+
   std::ifstream _in_db;
+  mapped_file _in_map; // input file, when it is in binary format
   std::string filename; // Holds the file name of the dataset
   unsigned long _max_mem;
   TKNZ tknz; // An object of Tokenizer class
   unsigned int _trans_cnt;
+  TRANS_DB *_trans_db; // transactions are kept here, if set
 }; // end class db_reader<itemset>
 
 #endif
@@ -23,6 +23,7 @@
 #ifndef _ELEMENT_PARSER
 #define _ELEMENT_PARSER
 #include "helper_funs.h"
+#include "label_dict.h"
 #include <cstring>
 #include <iostream>
 #include <sstream>
@@ -45,6 +46,7 @@ template <> class element_parser<int> {
 public:
   typedef int OBJ_T;     /**< element type */
   typedef int HASH_TYPE; // Input type for the hash function.
+  static const bool keeps_dict = false; // labels need no add_labels()
 
   /** \fn OBJ_T parse_element(char* word)
    * \brief parse characters in word to type OBJ_T
@@ -59,6 +61,8 @@ public:
 
   static const HASH_TYPE &conv_hash_type(const OBJ_T &s) { return s; }
 
+  static void add_labels(const std::vector<std::string> &) {}
+
 }; // end clas element_parser<int>
    //
 template <> struct COMP_FUNC<int> {
@@ -75,6 +79,7 @@ template <> class element_parser<std::string> {
 public:
   typedef std::string OBJ_T;     /**< element type */
   typedef const char *HASH_TYPE; // Input type for the hash function.
+  static const bool keeps_dict = false;
   /** \fn OBJ_T parse_element(char* word)
    * \brief parse characters in word to type OBJ_T
    * \param word input set of characters
@@ -105,6 +110,8 @@ public:
     return ret;
   }
 
+  static void add_labels(const std::vector<std::string> &) {}
+
 }; // end clas element_parser<std::string>
 
 template <> struct COMP_FUNC<const char *> {
@@ -113,4 +120,55 @@ template <> struct COMP_FUNC<const char *> {
   }
 };
 
+/**
+ * \brief Element parser class for parsing a string label into its id in
+ * label_dict, an specialization of element_parser class.
+ *
+ * Mining on dict_label works on integers; the texts are only looked up when
+ * labels are printed. The labels of a database should be given to
+ * add_labels() before it is parsed, so that ids follow text order.
+ */
+template <> class element_parser<dict_label> {
+
+public:
+  typedef dict_label OBJ_T;     /**< element type */
+  typedef dict_label HASH_TYPE; // Input type for the hash function.
+  static const bool keeps_dict = true;
+
+  static inline OBJ_T parse_element(const char *word) {
+    return dict_label(label_dict::instance().id(std::string(word)));
+  }
+
+  static inline OBJ_T parse_element(const std::string &word) {
+    return dict_label(label_dict::instance().id(word));
+  }
+
+  static OBJ_T convert(const char *s) { return parse_element(s); }
+
+  static OBJ_T convert(const int i) {
+    std::ostringstream t_ss;
+    t_ss << i;
+
+    return parse_element(t_ss.str());
+  }
+
+  static bool notEq(const dict_label &l1, const dict_label &l2) {
+    return l1 != l2;
+  }
+
+  static const HASH_TYPE &conv_hash_type(const OBJ_T &s) { return s; }
+
+  /** Adds the labels of a database to the dictionary */
+  static void add_labels(const std::vector<std::string> &labels) {
+    label_dict::instance().add(labels);
+  }
+
+}; // end clas element_parser<dict_label>
+
+template <> struct COMP_FUNC<dict_label> {
+  bool operator()(const dict_label &lhs, const dict_label &rhs) const {
+    return lhs == rhs;
+  }
+};
+
 #endif
@@ -20,6 +20,8 @@
 #ifndef _GENERIC_CLASSES_H_
 #define _GENERIC_CLASSES_H_
 
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 /**
@@ -48,6 +50,29 @@ template <class PP, class MP,
           template <typename P, typename A> class ST = std::vector>
 class vat {};
 
+/**
+ * \brief VAT storage type that packs the VAT into arena-allocated blocks.
+ *
+ * Passed as the ST argument of vat, in place of std::vector; it only selects
+ * a specialization and is never instantiated itself.
+ */
+template <typename P, typename A = std::allocator<P>> class arena_storage {};
+
+/**
+ * \brief VAT storage type whose embeddings only hold what they add to an
+ * embedding of the parent pattern's VAT.
+ *
+ * Passed as the ST argument of vat, like arena_storage.
+ */
+template <typename P, typename A = std::allocator<P>> class linked_storage {};
+
+/**
+ * \brief True for the VAT types that may only be intersected while owned by
+ * shared_ptrs, as with concurrent_memory_storage; storage managers holding
+ * plain VAT pointers refuse to intersect them at compile time.
+ */
+template <class VAT> struct shared_vats_only : std::false_type {};
+
 /**
  * \brief Class represent a generic tokenizer.
  *
@@ -60,7 +85,8 @@ template <typename, typename> class tokenizer {};
  *
  */
 template <class PP, class TRANS, class st,
-          template <typename, typename, typename> class CC, class sm_type>
+          template <typename, typename, typename> class CC, class sm_type,
+          template <typename, typename> class vat_st = std::vector>
 class count_support {};
 
 /**
@@ -77,6 +103,12 @@ class storage_type {};
  */
 class memory_storage : public storage_type {};
 
+/**
+ * \brief Memory based Storage Manager class that may be shared by several
+ * mining threads, extended from base storage type.
+ */
+class concurrent_memory_storage : public storage_type {};
+
 /**
  * \brief File based Storage Manager class, extended from base storage type.
  *
@@ -0,0 +1,195 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file label_dict.h - dictionary encoding of string labels as dense
+ * integer ids */
+#ifndef _LABEL_DICT_H
+#define _LABEL_DICT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hash_utils.hpp"
+
+/**
+ * \brief Process-wide dictionary of labels, mapping each label text to a
+ * dense id and back.
+ *
+ * The labels of a database are added, all at once, before it is parsed;
+ * they get their ids in text order, so comparing ids orders labels the same
+ * way as comparing their texts, and canonical codes do not change with the
+ * encoding. A label first seen later is given the next free id. Looking up
+ * the text or hash of an id takes no lock: entries live in chunks that
+ * never move and are published through _size.
+ */
+class label_dict {
+public:
+  static label_dict &instance() {
+    static label_dict dict;
+    return dict;
+  }
+
+  ~label_dict() {
+    for (unsigned int k = 0; k < NUM_CHUNKS; k++)
+      delete[] _chunks[k].load(std::memory_order_relaxed);
+  }
+
+  /** Adds the labels not yet in the dictionary, in text order */
+  void add(const std::vector<std::string> &labels) {
+    std::vector<std::string> sorted(labels);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::unique_lock<std::shared_mutex> lock(_mtx);
+    for (unsigned int i = 0; i < sorted.size(); i++)
+      if (_ids.find(sorted[i]) == _ids.end())
+        push_back(sorted[i]);
+  }
+
+  /** Returns the id of label s, adding it if it is new */
+  uint32_t id(const std::string &s) {
+    {
+      std::shared_lock<std::shared_mutex> lock(_mtx);
+      std::unordered_map<std::string, uint32_t>::const_iterator it =
+          _ids.find(s);
+      if (it != _ids.end())
+        return it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(_mtx);
+    std::unordered_map<std::string, uint32_t>::const_iterator it = _ids.find(s);
+    if (it != _ids.end()) // added in the meantime
+      return it->second;
+    return push_back(s);
+  }
+
+  /** Text of label id; empty for an id never handed out */
+  const std::string &text(const uint32_t &id) const {
+    static const std::string none;
+    if (id >= _size.load(std::memory_order_acquire))
+      return none;
+    return at(id).text;
+  }
+
+  /** Hash of the text of label id, the one myhash<const char*> gives */
+  size_t hash(const uint32_t &id) const {
+    if (id >= _size.load(std::memory_order_acquire))
+      return 0;
+    return at(id).hash;
+  }
+
+  uint32_t size() const { return _size.load(std::memory_order_acquire); }
+
+private:
+  struct entry {
+    std::string text;
+    size_t hash;
+  };
+
+  // chunk k holds FIRST_CHUNK << k entries
+  static const unsigned int FIRST_BITS = 6;
+  static const unsigned int NUM_CHUNKS = 32 - FIRST_BITS;
+
+  label_dict() : _size(0) {
+    for (unsigned int k = 0; k < NUM_CHUNKS; k++)
+      _chunks[k].store(0, std::memory_order_relaxed);
+  }
+
+  label_dict(const label_dict &) = delete;
+  label_dict &operator=(const label_dict &) = delete;
+
+  static void locate(const uint32_t &id, unsigned int &k, uint64_t &off) {
+    uint64_t x = (uint64_t)id + (1u << FIRST_BITS);
+    k = 63 - __builtin_clzll(x) - FIRST_BITS;
+    off = x - ((uint64_t)1 << (k + FIRST_BITS));
+  }
+
+  const entry &at(const uint32_t &id) const {
+    unsigned int k;
+    uint64_t off;
+    locate(id, k, off);
+    return _chunks[k].load(std::memory_order_acquire)[off];
+  }
+
+  // called with _mtx held exclusively
+  uint32_t push_back(const std::string &s) {
+    uint32_t id = _size.load(std::memory_order_relaxed);
+    unsigned int k;
+    uint64_t off;
+    locate(id, k, off);
+    entry *chunk = _chunks[k].load(std::memory_order_relaxed);
+    if (!chunk) {
+      chunk = new entry[(size_t)1 << (k + FIRST_BITS)];
+      _chunks[k].store(chunk, std::memory_order_release);
+    }
+    chunk[off].text = s;
+    chunk[off].hash = hash_bytes(s.c_str(), s.size());
+    _ids.insert(std::make_pair(s, id));
+    _size.store(id + 1, std::memory_order_release);
+    return id;
+  }
+
+  std::shared_mutex _mtx; // guards _ids and adding entries
+  std::unordered_map<std::string, uint32_t> _ids;
+  std::atomic<entry *> _chunks[NUM_CHUNKS];
+  std::atomic<uint32_t> _size; // number of entries published
+
+}; // end class label_dict
+
+/**
+ * \brief A label encoded by its id in label_dict; compares, hashes and
+ * copies as an integer and prints as its text.
+ */
+struct dict_label {
+  dict_label() : _id(0) {}
+  explicit dict_label(const uint32_t &id) : _id(id) {}
+
+  uint32_t id() const { return _id; }
+  const std::string &text() const { return label_dict::instance().text(_id); }
+
+  bool operator==(const dict_label &rhs) const { return _id == rhs._id; }
+  bool operator!=(const dict_label &rhs) const { return _id != rhs._id; }
+  bool operator<(const dict_label &rhs) const { return _id < rhs._id; }
+  bool operator>(const dict_label &rhs) const { return _id > rhs._id; }
+  bool operator<=(const dict_label &rhs) const { return _id <= rhs._id; }
+  bool operator>=(const dict_label &rhs) const { return _id >= rhs._id; }
+
+private:
+  uint32_t _id;
+
+}; // end struct dict_label
+
+inline std::ostream &operator<<(std::ostream &ostr, const dict_label &l) {
+  return ostr << l.text();
+}
+
+/** Hashes a label as its text is hashed, so hashed containers keyed by
+ * labels keep the layout they have with string labels */
+template <> struct myhash<dict_label> {
+  std::size_t operator()(const dict_label &l) const noexcept {
+    return label_dict::instance().hash(l.id());
+  }
+};
+
+#endif
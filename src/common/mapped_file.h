@@ -0,0 +1,126 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+#include <fcntl.h>
+#include <istream>
+#include <streambuf>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * \brief Read-only memory mapping of a whole file.
+ */
+class mapped_file {
+public:
+  mapped_file() : _data(0), _size(0) {}
+  ~mapped_file() { close(); }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  /** Maps the file; returns false if it cannot be opened or is empty */
+  bool open(const char *file_name) {
+    close();
+    int fd = ::open(file_name, O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+
+    void *p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference
+    if (p == MAP_FAILED)
+      return false;
+
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    _data = static_cast<const char *>(p);
+    _size = st.st_size;
+    return true;
+  }
+
+  void close() {
+    if (_data)
+      munmap(const_cast<char *>(_data), _size);
+    _data = 0;
+    _size = 0;
+  }
+
+  bool is_open() const { return _data != 0; }
+  const char *data() const { return _data; }
+  size_t size() const { return _size; }
+
+private:
+  const char *_data;
+  size_t _size;
+
+}; // end class mapped_file
+
+/**
+ * \brief Read-only stream buffer over a range of memory, e.g. a part of a
+ * mapped_file; supports tellg() and seekg().
+ */
+class mem_streambuf : public std::streambuf {
+public:
+  mem_streambuf(const char *b, const char *e) {
+    setg(const_cast<char *>(b), const_cast<char *>(b), const_cast<char *>(e));
+  }
+
+protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode) {
+    char *p;
+    if (dir == std::ios_base::beg)
+      p = eback() + off;
+    else if (dir == std::ios_base::cur)
+      p = gptr() + off;
+    else
+      p = egptr() + off;
+    if (p < eback() || p > egptr())
+      return pos_type(off_type(-1));
+    setg(eback(), p, egptr());
+    return pos_type(p - eback());
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+/**
+ * \brief Input stream over a range of memory.
+ */
+class mem_istream : public std::istream {
+public:
+  mem_istream(const char *b, const char *e) : std::istream(0), _buf(b, e) {
+    rdbuf(&_buf);
+  }
+
+private:
+  mem_streambuf _buf;
+};
+
+#endif
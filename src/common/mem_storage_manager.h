@@ -32,8 +32,6 @@
 
 using namespace std;
 
-// time_tracker tt_tot_inter;
-
 /**
  * \brief Storage Manager class partially specialized to Memory-based Storage
  * manager to stores VAT in Memory.
@@ -160,6 +158,9 @@ public:
   VAT **intersect(PAT *const &p1, PAT *const &p2, PAT_SUP **cand_sups,
                   PAT **cand_pats, const bool &isfwd, const pair<int, int> &ids,
                   const int &minsup) {
+    static_assert(!shared_vats_only<VAT>::value,
+                  "this VAT layout is intersected through "
+                  "concurrent_memory_storage only");
 
     // Get the vats.
     VAT *v1, *v2;
@@ -193,6 +194,26 @@ public:
     return ret;
   }
 
+  /**
+   * Batched intersect(): candidate i adds the edge p2 from vertex src of p1
+   * to its vertex dests[i], or to a new vertex when dests[i] is p1's size.
+   */
+  VAT **intersect(PAT *const &p1, PAT *const &p2, PAT_SUP **cand_sups,
+                  PAT **cand_pats, const int &num, const int &src,
+                  const int *dests, const int &minsup) {
+    static_assert(!shared_vats_only<VAT>::value,
+                  "this VAT layout is intersected through "
+                  "concurrent_memory_storage only");
+    VAT *v1 = get_vat(p1), *v2 = get_vat(p2);
+    if (!v1 || !v2) {
+      cout << "storage_manager: vat not found for pattern = "
+           << (v1 ? p2 : p1)->pat_id() << endl;
+      return 0;
+    }
+    return VAT::intersection(v1, v2, cand_sups, cand_pats, num, src, dests,
+                             minsup);
+  }
+
   void print() const {
     CONST_IT hmap_it;
     for (hmap_it = _pat_to_vat.begin(); hmap_it != _pat_to_vat.end(); hmap_it++)
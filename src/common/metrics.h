@@ -0,0 +1,274 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file metrics.h - counters and cycle timers of the hot paths, kept per
+ * thread and dumped as JSON */
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * \brief Registry of the run's metrics: a count for each, and for the
+ * timers the cycles spent as well.
+ *
+ * Every thread updates a slot of its own, enrolled on its first update and
+ * kept until the process exits, so updates take no lock and the totals of
+ * finished threads are not lost; dump() adds up all slots. Each value has a
+ * single writer, so it is updated by a relaxed load and store, and may be
+ * read while the run goes on.
+ *
+ * Cycles are read from the time stamp counter where there is one, and are
+ * turned into seconds in the dump by the rate the counter ran at since the
+ * registry was created.
+ *
+ * Nothing is counted or timed until dump_to() turns the metrics on, so a
+ * run without them only tests a flag; built with -DNO_METRICS, the flag is
+ * a constant false and the updates compile away.
+ */
+class metrics {
+public:
+  enum id {
+    TOKENIZE,       /**< reading the transactions (timer) */
+    LEVEL_ONE,      /**< building the level-one patterns and maps (timer) */
+    ISECT_FWD,      /**< intersections of forward-edge candidates (timer) */
+    ISECT_BACK,     /**< intersections of back-edge candidates (timer) */
+    ISECT_BATCH,    /**< batches of both kinds of candidates (timer) */
+    ISO_CHECK,      /**< minimum DFS codes (timer) */
+    PAT_CLONE,      /**< copies of patterns (timer) */
+    PAT_ALLOC,      /**< patterns allocated */
+    VAT_ALLOC,      /**< VATs allocated */
+    VERDICT_HIT,    /**< candidates whose verdict was known */
+    VERDICT_MISS,   /**< candidates looked up without a verdict */
+    VAT_CACHE_HIT,  /**< candidate VATs found in the VAT cache */
+    VAT_CACHE_MISS, /**< candidate VATs looked up and not found */
+    FAILED_MAP_HIT, /**< walk edges skipped as already failed */
+    NUM_METRICS
+  };
+
+  /** Whether metrics are kept */
+  static bool on() {
+#ifdef NO_METRICS
+    return false;
+#else
+    return enabled();
+#endif
+  }
+
+  /** Counts n events of m */
+  static void add(const id &m, const uint64_t &n = 1) {
+    if (!on())
+      return;
+    slot &s = local();
+    s.count[m].store(s.count[m].load(std::memory_order_relaxed) + n,
+                     std::memory_order_relaxed);
+  }
+
+  /** Counts an event of the timer m that took cycles */
+  static void add_cycles(const id &m, const uint64_t &cycles) {
+    if (!on())
+      return;
+    slot &s = local();
+    s.count[m].store(s.count[m].load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    s.cycles[m].store(s.cycles[m].load(std::memory_order_relaxed) + cycles,
+                      std::memory_order_relaxed);
+  }
+
+  /** Current cycle count */
+  static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  /** Writes the totals over all threads to out, as one JSON object */
+  static void dump(std::ostream &out) {
+    uint64_t count[NUM_METRICS] = {0}, cycles[NUM_METRICS] = {0};
+    unsigned int threads = 0;
+    for (slot *s = slots().load(std::memory_order_acquire); s; s = s->next) {
+      for (unsigned int m = 0; m < NUM_METRICS; m++) {
+        count[m] += s->count[m].load(std::memory_order_relaxed);
+        cycles[m] += s->cycles[m].load(std::memory_order_relaxed);
+      }
+      threads++;
+    }
+
+    const clock_start &st = start();
+    double secs = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - st.time)
+                      .count();
+    double rate = secs > 0 ? (now() - st.cycles) / secs : 0; // cycles/sec
+
+    out << "{\n  \"seconds\": " << secs << ",\n  \"threads\": " << threads;
+    for (unsigned int m = 0; m < NUM_METRICS; m++) {
+      out << ",\n  \"" << name(m) << "\": ";
+      if (is_timer(m))
+        out << "{\"count\": " << count[m] << ", \"cycles\": " << cycles[m]
+            << ", \"seconds\": " << (rate > 0 ? cycles[m] / rate : 0) << "}";
+      else
+        out << count[m];
+    }
+    out << "\n}\n";
+  }
+
+  /** dump() to the file path, replacing it */
+  static void dump(const char *path) {
+    std::ofstream out(path);
+    if (!out) {
+      std::cerr << "metrics: cannot write " << path << std::endl;
+      return;
+    }
+    dump(out);
+  }
+
+  /**
+   * Turns the metrics on, and has them dumped to path when the process
+   * exits and whenever it gets SIGUSR1. Call it before any other thread is
+   * started: the signal is blocked in all threads but one that waits for
+   * it, where the dump does not have to be async-signal-safe.
+   */
+  static void dump_to(const char *path) {
+    enabled() = true;
+    dump_path() = path;
+    start();
+    std::atexit([]() { dump(dump_path()); });
+
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, 0);
+    std::thread([set]() {
+      int sig;
+      while (!sigwait(&set, &sig))
+        dump(dump_path());
+    }).detach();
+  }
+
+private:
+  struct slot {
+    std::atomic<uint64_t> count[NUM_METRICS];
+    std::atomic<uint64_t> cycles[NUM_METRICS];
+    slot *next;
+  };
+
+  struct clock_start {
+    std::chrono::steady_clock::time_point time;
+    uint64_t cycles;
+  };
+
+  static const char *name(const unsigned int &m) {
+    static const char *names[NUM_METRICS] = {
+        "tokenize",      "level_one",    "isect_fwd",      "isect_back",
+        "isect_batch",   "iso_check",    "pat_clone",      "pat_alloc",
+        "vat_alloc",     "verdict_hit",  "verdict_miss",   "vat_cache_hit",
+        "vat_cache_miss", "failed_map_hit"};
+    return names[m];
+  }
+
+  static bool is_timer(const unsigned int &m) { return m <= PAT_CLONE; }
+
+  static std::atomic<slot *> &slots() {
+    static std::atomic<slot *> head(0);
+    return head;
+  }
+
+  // set only before the threads that update the metrics are started
+  static bool &enabled() {
+    static bool on = false;
+    return on;
+  }
+
+  static const char *&dump_path() {
+    static const char *path = 0;
+    return path;
+  }
+
+  static const clock_start &start() {
+    static const clock_start st = {std::chrono::steady_clock::now(), now()};
+    return st;
+  }
+
+  // the slot of this thread, enrolled on first use and never freed
+  static slot &local() {
+    static thread_local slot *s = enroll();
+    return *s;
+  }
+
+  static slot *enroll() {
+    start();
+    slot *s = new slot;
+    for (unsigned int m = 0; m < NUM_METRICS; m++) {
+      s->count[m].store(0, std::memory_order_relaxed);
+      s->cycles[m].store(0, std::memory_order_relaxed);
+    }
+    s->next = slots().load(std::memory_order_relaxed);
+    while (!slots().compare_exchange_weak(s->next, s,
+                                          std::memory_order_release))
+      ;
+    return s;
+  }
+
+}; // end class metrics
+
+/**
+ * \brief Times a scope, or up to stop(), for the timer metric m; reads no
+ * clock while the metrics are off.
+ */
+class metric_timer {
+public:
+  explicit metric_timer(const metrics::id &m)
+      : _m(m), _running(metrics::on()) {
+    _start = _running ? metrics::now() : 0;
+  }
+
+  ~metric_timer() { stop(); }
+
+  void stop() {
+    if (!_running)
+      return;
+    metrics::add_cycles(_m, metrics::now() - _start);
+    _running = false;
+  }
+
+private:
+  metrics::id _m;
+  uint64_t _start;
+  bool _running;
+
+  metric_timer(const metric_timer &) = delete;
+  metric_timer &operator=(const metric_timer &) = delete;
+
+}; // end class metric_timer
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file orthogonal_reps.h - selection of alpha-orthogonal, beta-representative
+ * patterns among the sampled maximal patterns */
+#ifndef _ORTHOGONAL_REPS_H
+#define _ORTHOGONAL_REPS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \brief Picks orthogonal representatives among sampled maximal patterns.
+ *
+ * Two patterns are as similar as the Jaccard index of their tid sets (see
+ * vat::get_tid_distance()). A set of patterns is alpha-orthogonal when no two
+ * of them are more than alpha similar, i.e. it is a clique of the
+ * alpha-orthogonality graph; a pattern is beta-represented by the set when it
+ * is at least beta similar to one of its members. select() looks for the
+ * maximal clique that leaves the fewest patterns unrepresented (the residue).
+ *
+ * The orthogonality graph is never built. A clique is grown greedily along a
+ * random order, keeping for every pattern its highest similarity to the
+ * clique so far: a pattern may join while that value is at most alpha, and
+ * once the order is exhausted the same values tell which patterns are
+ * represented. Growing a clique of k patterns thus costs k passes over the
+ * sample. The best of several random cliques is then improved by local
+ * search: an unrepresented pattern is swapped in for the members it
+ * conflicts with and the clique is regrown, and the swap is kept if the
+ * residue went down.
+ *
+ * Tid sets are stored as bitsets trimmed to their first and last nonzero
+ * word, all in one array; a similarity is one AND/popcount over the words
+ * the two sets share, and is skipped when the bound min(|a|,|b|)/max(|a|,|b|)
+ * shows it cannot change anything.
+ */
+template <typename KEY> class orthogonal_reps {
+public:
+  orthogonal_reps(const double &alpha, const double &beta)
+      : _alpha(alpha), _beta(beta), _residue(0) {}
+
+  /** Adds a pattern with its tid list, in increasing tid order */
+  void add(const KEY &key, const vector<unsigned int> &tids) {
+    tid_set s;
+    s.off = _words.size();
+    s.count = tids.size();
+    s.lo = tids.empty() ? 0 : tids.front() / 64;
+    s.hi = tids.empty() ? 0 : tids.back() / 64 + 1;
+    _words.resize(s.off + (s.hi - s.lo), 0);
+    for (unsigned int i = 0; i < tids.size(); i++)
+      _words[s.off + tids[i] / 64 - s.lo] |= (uint64_t)1 << (tids[i] % 64);
+    _sets.push_back(s);
+    _keys.push_back(key);
+  }
+
+  unsigned int size() const { return _sets.size(); }
+
+  const KEY &key(const unsigned int &i) const { return _keys[i]; }
+
+  /** Jaccard index of the tid sets of patterns i and j */
+  double similarity(const unsigned int &i, const unsigned int &j) const {
+    const tid_set &a = _sets[i];
+    const tid_set &b = _sets[j];
+    unsigned int lo = max(a.lo, b.lo), hi = min(a.hi, b.hi);
+    unsigned int common = 0;
+    for (unsigned int w = lo; w < hi; w++)
+      common += __builtin_popcountll(_words[a.off + w - a.lo] &
+                                     _words[b.off + w - b.lo]);
+    unsigned int uni = a.count + b.count - common;
+    return uni ? (double)common / uni : 1.0;
+  }
+
+  /**
+   * Selects the representatives: the best of restarts random cliques,
+   * improved by as many local search steps.
+   */
+  void select(const unsigned int &restarts, const unsigned int &seed) {
+    _reps.clear();
+    _residue = 0;
+    if (_sets.empty())
+      return;
+
+    std::mt19937 rng(seed);
+    vector<unsigned int> order(_sets.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+      order[i] = i;
+
+    vector<unsigned int> clique, empty;
+    vector<double> best;
+    unsigned int residue;
+    for (unsigned int r = 0; r < max(restarts, 1u); r++) {
+      shuffle(order.begin(), order.end(), rng);
+      residue = grow(empty, order, clique, best);
+      if (r == 0 || better(residue, clique.size()))
+        keep(clique, best, residue);
+    }
+
+    for (unsigned int step = 0; step < restarts && _residue > 0; step++) {
+      // an unrepresented pattern, picked at random
+      unsigned int u = rng() % _residue, v = 0;
+      for (;; v++)
+        if (_best[v] < _beta && !_in_reps[v] && u-- == 0)
+          break;
+
+      vector<unsigned int> seed_set(1, v);
+      for (unsigned int k = 0; k < _reps.size(); k++)
+        if (similarity(v, _reps[k]) <= _alpha)
+          seed_set.push_back(_reps[k]);
+
+      shuffle(order.begin(), order.end(), rng);
+      residue = grow(seed_set, order, clique, best);
+      if (better(residue, clique.size()))
+        keep(clique, best, residue);
+    }
+  }
+
+  /** Indices of the representatives, in the order they were picked */
+  const vector<unsigned int> &reps() const { return _reps; }
+
+  /** Number of patterns neither picked nor beta-represented */
+  unsigned int residue() const { return _residue; }
+
+private:
+  struct tid_set {
+    size_t off;         // first word in _words
+    unsigned int lo;    // tid / 64 of the first stored word
+    unsigned int hi;    // one past the last stored word
+    unsigned int count; // number of tids
+  };
+
+  /** Upper bound of the similarity of patterns i and j */
+  double bound(const unsigned int &i, const unsigned int &j) const {
+    unsigned int a = _sets[i].count, b = _sets[j].count;
+    return a < b ? (double)a / b : (b ? (double)b / a : 1.0);
+  }
+
+  /**
+   * Grows a clique from seed_set, trying the other patterns along order.
+   * best receives each pattern's highest similarity to the clique (or 2 for
+   * members); returns the residue.
+   */
+  unsigned int grow(const vector<unsigned int> &seed_set,
+                    const vector<unsigned int> &order,
+                    vector<unsigned int> &clique, vector<double> &best) const {
+    clique.clear();
+    best.assign(_sets.size(), 0.0);
+    for (unsigned int k = 0; k < seed_set.size(); k++)
+      join(seed_set[k], clique, best);
+    for (unsigned int k = 0; k < order.size(); k++)
+      if (best[order[k]] <= _alpha)
+        join(order[k], clique, best);
+
+    unsigned int residue = 0;
+    for (unsigned int i = 0; i < best.size(); i++)
+      if (best[i] < _beta)
+        residue++;
+    return residue;
+  }
+
+  void join(const unsigned int &p, vector<unsigned int> &clique,
+            vector<double> &best) const {
+    clique.push_back(p);
+    best[p] = 2.0;
+    for (unsigned int q = 0; q < best.size(); q++) {
+      if (best[q] > 1.0 || bound(p, q) <= best[q])
+        continue;
+      double s = similarity(p, q);
+      if (s > best[q])
+        best[q] = s;
+    }
+  }
+
+  /** Fewer unrepresented patterns, then fewer representatives */
+  bool better(const unsigned int &residue, const size_t &size) const {
+    return residue < _residue || (residue == _residue && size < _reps.size());
+  }
+
+  void keep(const vector<unsigned int> &clique, const vector<double> &best,
+            const unsigned int &residue) {
+    _reps = clique;
+    _best = best;
+    _residue = residue;
+    _in_reps.assign(_sets.size(), false);
+    for (unsigned int k = 0; k < _reps.size(); k++)
+      _in_reps[_reps[k]] = true;
+  }
+
+  double _alpha;
+  double _beta;
+  vector<KEY> _keys;
+  vector<tid_set> _sets;
+  vector<uint64_t> _words; // bitsets of all tid sets
+
+  vector<unsigned int> _reps;
+  vector<double> _best; // of the selected clique, see grow()
+  vector<bool> _in_reps;
+  unsigned int _residue;
+
+}; // end class orthogonal_reps
+
+#endif
@@ -31,7 +31,8 @@
 using namespace std;
 
 template <class PP, class TRANS, class ST,
-          template <class, typename, typename> class CC, class SM_TYPE>
+          template <class, typename, typename> class CC, class SM_TYPE,
+          template <typename, typename> class VAT_ST>
 class count_support;
 
 template <class PP, class MP, class ST,
@@ -58,10 +59,10 @@ template <class PP, class MP, class PAT_ST,
 ostream &operator<<(ostream &ostr, const GRAPH_PATTERN *p);
 
 #include "adj_list.h"
+#include "alloc_policy.h"
+#include "metrics.h"
 #include "pat_support.h"
 
-template <typename T> using ALLOC = std::allocator<T>;
-
 /**
  * \brief The Pattern Class
  *
@@ -92,19 +93,17 @@ public:
   typedef typename CAN_CODE::COMPARISON_FUNC CC_COMPARISON_FUNC;
 
   void *operator new(size_t size) {
-    ALLOC<PATTERN> pa;
-    return pa.allocate(size);
+    metrics::add(metrics::PAT_ALLOC);
+    return alloc_bytes<WALK_ALLOC>(size);
   }
 
   void operator delete(void *p, size_t size) {
-    if (p) {
-      ALLOC<PATTERN> pa;
-      pa.deallocate(static_cast<PATTERN *>(p), size);
-    }
+    free_bytes<WALK_ALLOC>(p, size);
   }
 
   // pattern constructor, mostly does nothing
-  pattern() : _rmost_vid(-1), _is_canonical(false), _edge_cnt(0) {}
+  pattern()
+      : _rmost_vid(-1), _is_canonical(false), _edge_cnt(0), _base(0) {}
 
   IT begin() { return _graph.begin(); }
   CONST_IT begin() const { return _graph.begin(); }
@@ -117,6 +116,7 @@ public:
 
   /** Creates a deep copy of this object into rhs */
   pattern<PATTERN_PROPS, MINING_PROPS, ST, CC> *exact_clone() const {
+    metric_timer t(metrics::PAT_CLONE);
     pattern<PATTERN_PROPS, MINING_PROPS, ST, CC> *clone =
         new pattern<PATTERN_PROPS, MINING_PROPS, ST, CC>();
 
@@ -135,8 +135,59 @@ public:
     return clone;
   } // end clone()
 
+  /**
+   * Creates a candidate extending this pattern by the edge of tuple t, from
+   * vertex t._i to t._j (a new vertex if t._j is size()), in O(1): the
+   * candidate shares this pattern's graph and code and holds only t, its
+   * own id and its support. Only pat_id(), key() and the support may be
+   * used until materialize() is called; this pattern must live until then,
+   * or until the candidate is deleted.
+   */
+  pattern<PATTERN_PROPS, MINING_PROPS, ST, CC> *
+  extension(const CC_INIT_TYPE &t) const {
+    pattern<PATTERN_PROPS, MINING_PROPS, ST, CC> *ext =
+        new pattern<PATTERN_PROPS, MINING_PROPS, ST, CC>();
+    ext->_base = this;
+    ext->_ext = t;
+    return ext;
+  } // end extension()
+
+  bool is_extension() const { return _base != 0; }
+
+  /** Turns an extension() into a pattern of its own, copying its base and
+   * adding its edge; the id stays the same */
+  void materialize() {
+    if (!_base)
+      return;
+    metric_timer t(metrics::PAT_CLONE);
+    CC_STORAGE_TYPE id = pat_id();
+    CONST_IT it;
+    for (it = _base->begin(); it != _base->end(); it++)
+      _graph.push_back(*it);
+    _rmost_vid = _base->_rmost_vid;
+    _rmost_path = _base->_rmost_path;
+    _canonical_code = _base->_canonical_code;
+    _canonical_code.set_code(id);
+    _edge_cnt = _base->_edge_cnt;
+    _base = 0;
+
+    if (_ext._j == (int)size())
+      add_vertex(_ext._lj);
+    add_out_edge(_ext._i, _ext._j, _ext._lij);
+    add_out_edge(_ext._j, _ext._i, _ext._lij);
+    _canonical_code.push_back(_ext);
+  } // end materialize()
+
+  /** Packed canonical code, see CAN_CODE::key() */
+  decltype(std::declval<const CAN_CODE &>().key()) key() const {
+    if (_base)
+      return _base->_canonical_code.key(_ext);
+    return _canonical_code.key();
+  }
+
   /** Creates a deep copy of this object into rhs and update the id*/
   pattern<PATTERN_PROPS, MINING_PROPS, ST, CC> *clone() const {
+    metric_timer t(metrics::PAT_CLONE);
     pattern<PATTERN_PROPS, MINING_PROPS, ST, CC> *clone =
         new pattern<PATTERN_PROPS, MINING_PROPS, ST, CC>();
 
@@ -291,6 +342,15 @@ This function should be invoked for digraphs ONLY */
     }
     return ret_val;
   }
+
+  // fills vids with the ids of the vertices labelled v_label
+  void get_vids_for_this_label(VERTEX_T v_label, vector<int> &vids) const {
+    vids.clear();
+    for (unsigned int i = 0; i < size(); i++)
+      if (_graph.vertex_vals(i)->v == v_label)
+        vids.push_back(i);
+  }
+
   int get_edge_freq(VERTEX_T src_l, VERTEX_T dest_l, EDGE_T e_l) {
     vector<int> *s_ids;
     vector<int> *d_ids;
@@ -339,6 +399,9 @@ private:
   bool _is_canonical;
   unsigned int _edge_cnt; // no of edge in this pattern
   RMP_T _rmost_path;      // ids of vertices on right most path
+  // an extension() not yet materialized: the pattern it extends, by _ext
+  const pattern<PATTERN_PROPS, MINING_PROPS, ST, CC> *_base;
+  CC_INIT_TYPE _ext;
 
 }; // end class pattern
 
@@ -0,0 +1,166 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file stop_policy.h - when the random walks have sampled enough of the
+ * maximal patterns */
+#ifndef _STOP_POLICY_H
+#define _STOP_POLICY_H
+
+#include <chrono>
+#include <ctime>
+
+/**
+ * \brief Decides when the sampling loop stops.
+ *
+ * Every walk ends at a maximal pattern, so the walks draw a sample of the
+ * maximal patterns, with repeats. From the number of walks n and the
+ * numbers f1 and f2 of patterns reached exactly once and exactly twice:
+ *
+ * - the Good-Turing estimate of the probability that the next walk reaches
+ *   a pattern not seen yet is f1 / n, and the sample coverage 1 - f1 / n;
+ * - the Chao1 (capture-recapture) estimate of the number of maximal
+ *   patterns is d + f1^2 / (2 f2), for the d distinct patterns seen, or
+ *   d + f1 (f1 - 1) / 2 while f2 is 0.
+ *
+ * The coverage gain is the expected share of the estimated patterns a walk
+ * adds, (f1 / n) / total, times the walks per CPU-second of the run so far.
+ * Once it falls below min_gain, after at least min_walks walks, the next
+ * CPU-second is not expected to find that share of the patterns any more.
+ *
+ * The loop also stops at max_pats distinct patterns, after max_idle walks in
+ * a row found none, and at the deadline; each rule is off when its limit is
+ * 0. The deadline is a hard one: walks check past_deadline() at every step
+ * and are abandoned once it holds. check() and past_deadline() are called
+ * by all walker threads and only read the policy.
+ */
+class stop_policy {
+public:
+  enum reason { NONE, MAX_PATS, IDLE, GAIN, DEADLINE };
+
+  /** The counts check() decides on */
+  struct sample {
+    unsigned long walks;    // walks recorded, n
+    unsigned long idle;     // walks ended since the last new pattern
+    unsigned long distinct; // distinct patterns, d
+    unsigned long once;     // patterns reached exactly once, f1
+    unsigned long twice;    // patterns reached exactly twice, f2
+  };
+
+  stop_policy(const unsigned long &max_pats = 0,
+              const unsigned long &max_idle = 999)
+      : _max_pats(max_pats), _max_idle(max_idle), _min_gain(0),
+        _min_walks(100), _deadline(0), _cpu_start(0) {
+    start();
+  }
+
+  /** Stops once the coverage gain per CPU-second is below min_gain, but not
+   * before min_walks walks */
+  void set_min_gain(const double &min_gain,
+                    const unsigned long &min_walks = 100) {
+    _min_gain = min_gain;
+    _min_walks = min_walks;
+  }
+
+  /** Stops seconds (wall clock) after start() */
+  void set_deadline(const double &seconds) { _deadline = seconds; }
+
+  /** Starts the clocks; the run starts when the policy is created, unless
+   * this is called again */
+  void start() {
+    _wall_start = std::chrono::steady_clock::now();
+    _cpu_start = std::clock();
+  }
+
+  /** The rule that says the loop should stop, NONE if it should go on */
+  reason check(const sample &s) const {
+    if (_max_pats && s.distinct >= _max_pats)
+      return MAX_PATS;
+    if (_max_idle && s.idle >= _max_idle)
+      return IDLE;
+    if (past_deadline())
+      return DEADLINE;
+    if (_min_gain > 0 && s.walks >= _min_walks && s.walks > 0) {
+      double cpu = cpu_seconds();
+      if (cpu > 0 && gain(s) * s.walks / cpu < _min_gain)
+        return GAIN;
+    }
+    return NONE;
+  }
+
+  /** Whether there is a deadline and it has passed */
+  bool past_deadline() const {
+    return _deadline > 0 && wall_seconds() >= _deadline;
+  }
+
+  /** Good-Turing sample coverage */
+  static double coverage(const sample &s) {
+    return s.walks ? 1.0 - (double)s.once / s.walks : 0;
+  }
+
+  /** Chao1 estimate of the number of maximal patterns */
+  static double estimated_total(const sample &s) {
+    double f1 = s.once, f2 = s.twice;
+    if (f2 > 0)
+      return s.distinct + f1 * f1 / (2 * f2);
+    return s.distinct + f1 * (f1 - 1) / 2;
+  }
+
+  /** Expected share of the estimated patterns the next walk adds */
+  static double gain(const sample &s) {
+    double total = estimated_total(s);
+    return s.walks && total > 0 ? (double)s.once / s.walks / total : 0;
+  }
+
+  static const char *describe(const reason &r) {
+    switch (r) {
+    case MAX_PATS:
+      return "maximal patterns found";
+    case IDLE:
+      return "walks without a new pattern";
+    case GAIN:
+      return "coverage gain per CPU-second below threshold";
+    case DEADLINE:
+      return "deadline reached";
+    default:
+      return "not stopped";
+    }
+  }
+
+  double wall_seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         _wall_start)
+        .count();
+  }
+
+  /** CPU time of the process, all threads, since start() */
+  double cpu_seconds() const {
+    return (double)(std::clock() - _cpu_start) / CLOCKS_PER_SEC;
+  }
+
+private:
+  unsigned long _max_pats;
+  unsigned long _max_idle;
+  double _min_gain;
+  unsigned long _min_walks;
+  double _deadline; // seconds, 0 for none
+  std::chrono::steady_clock::time_point _wall_start;
+  std::clock_t _cpu_start;
+
+}; // end class stop_policy
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file tid_bitset.h - the tids of a VAT as a bitset, for word-parallel
+ * tid intersections */
+#ifndef _TID_BITSET_H
+#define _TID_BITSET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Set of tids stored as a bitset, kept by a VAT next to its tid
+ * blocks.
+ *
+ * Only the words from the one of the smallest tid to the one of the largest
+ * are stored. Each word also records how many tids come before it, so the
+ * rank of a tid - the index of its block in the VAT - is one popcount away.
+ * Tids are added in increasing order, the way VATs are built.
+ */
+class tid_bitset {
+public:
+  tid_bitset() : _lo(0), _count(0) {}
+
+  /** Adds tid, which must be larger than all tids in the set */
+  void push_back(const unsigned int &tid) {
+    unsigned int w = tid / 64;
+    if (_words.empty())
+      _lo = w;
+    while (_lo + _words.size() <= w) {
+      _ranks.push_back(_count);
+      _words.push_back(0);
+    }
+    _words.back() |= (uint64_t)1 << (tid % 64);
+    _count++;
+  }
+
+  /** Removes tid, which must be the largest tid in the set */
+  void pop_back(const unsigned int &tid) {
+    _words[tid / 64 - _lo] &= ~((uint64_t)1 << (tid % 64));
+    _count--;
+    while (!_words.empty() && _words.back() == 0) {
+      _words.pop_back();
+      _ranks.pop_back();
+    }
+  }
+
+  void clear() {
+    _words.clear();
+    _ranks.clear();
+    _lo = 0;
+    _count = 0;
+  }
+
+  unsigned int size() const { return _count; }
+
+  /** Number of tids in both a and b */
+  static unsigned int count_common(const tid_bitset &a, const tid_bitset &b) {
+    unsigned int lo, hi;
+    if (!overlap(a, b, lo, hi))
+      return 0;
+    const uint64_t *wa = &a._words[lo - a._lo];
+    const uint64_t *wb = &b._words[lo - b._lo];
+    unsigned int n = 0;
+    for (unsigned int w = 0; w < hi - lo; w++)
+      n += __builtin_popcountll(wa[w] & wb[w]);
+    return n;
+  }
+
+  /**
+   * Calls f(tid, rank_a, rank_b) for every tid in both a and b, in tid
+   * order; rank_x is the number of tids of x smaller than tid.
+   */
+  template <typename FUNC>
+  static void for_common(const tid_bitset &a, const tid_bitset &b, FUNC f) {
+    unsigned int lo, hi;
+    if (!overlap(a, b, lo, hi))
+      return;
+    for (unsigned int w = lo; w < hi; w++) {
+      uint64_t wa = a._words[w - a._lo], wb = b._words[w - b._lo];
+      uint64_t m = wa & wb;
+      while (m) {
+        unsigned int bit = __builtin_ctzll(m);
+        uint64_t below = ((uint64_t)1 << bit) - 1;
+        f(w * 64 + bit, a._ranks[w - a._lo] + __builtin_popcountll(wa & below),
+          b._ranks[w - b._lo] + __builtin_popcountll(wb & below));
+        m &= m - 1;
+      }
+    }
+  }
+
+  /** Bytes taken by the words and ranks */
+  unsigned long int byte_size() const {
+    return _words.capacity() * sizeof(uint64_t) +
+           _ranks.capacity() * sizeof(unsigned int);
+  }
+
+private:
+  /** Range of words stored by both a and b; false if it is empty */
+  static bool overlap(const tid_bitset &a, const tid_bitset &b,
+                      unsigned int &lo, unsigned int &hi) {
+    lo = std::max(a._lo, b._lo);
+    hi = std::min(a._lo + (unsigned int)a._words.size(),
+                  b._lo + (unsigned int)b._words.size());
+    return lo < hi;
+  }
+
+  unsigned int _lo;                // tid / 64 of _words[0]
+  unsigned int _count;             // number of tids
+  std::vector<uint64_t> _words;    // bit tid % 64 of word tid / 64 - _lo
+  std::vector<unsigned int> _ranks; // tids before each word
+
+}; // end class tid_bitset
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file vat_cache.h - memory-budgeted cache of candidate VATs shared by all
+ * walks */
+#ifndef _VAT_CACHE_H
+#define _VAT_CACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Cache of the VATs of frequent candidates, so that a walk repeating
+ * the extensions of an earlier one reuses its VATs.
+ *
+ * VATs are held through the same reference-counted handles as in the
+ * concurrent storage manager; a VAT is never changed once built, so the
+ * cache and any number of walks can hold it at once and a hit costs no copy.
+ * The cache only counts the bytes of the VATs it holds against its budget.
+ *
+ * Eviction is GreedyDual-Size, a cost-aware LRU: an entry is worth
+ * L + cost / bytes, where cost is the time it took to build the VAT and L
+ * is the worth of the last entry evicted; a hit renews the worth of an
+ * entry, and the least worthy entry goes first. The key space is split over
+ * shards, each with its own lock, budget and L.
+ *
+ * Each shard gets an even share of the budget, and a VAT larger than that
+ * share is never cached: with the default 16 shards, that is any VAT over
+ * 4 MB when the budget is 64 MB. Such VATs are rebuilt on every walk that
+ * needs them; a larger budget, or fewer shards, lets them in.
+ */
+template <class KEY, class VAT, class SUP, class HASH> class vat_cache {
+public:
+  typedef std::shared_ptr<VAT> VAT_HANDLE;
+
+  vat_cache(const unsigned long int &budget_bytes,
+            const unsigned int &num_shards = 16)
+      : _shards(num_shards ? num_shards : 1), _hits(0), _misses(0),
+        _evictions(0) {
+    for (unsigned int i = 0; i < _shards.size(); i++)
+      _shards[i].budget = budget_bytes / _shards.size();
+  }
+
+  /** Looks up key; on a hit, h and sup receive the VAT and its support */
+  bool get(const KEY &key, VAT_HANDLE &h, SUP &sup) {
+    shard &s = get_shard(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    typename MAP::iterator it = s.entries.find(key);
+    if (it == s.entries.end()) {
+      _misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    _hits.fetch_add(1, std::memory_order_relaxed);
+    entry &e = it->second;
+    s.order.erase(e.pos);
+    e.pos = s.order.insert(std::make_pair(s.age + e.worth, &it->first));
+    h = e.vat;
+    sup = e.sup;
+    return true;
+  }
+
+  /**
+   * Offers the VAT h of key, with its support, built in cost seconds. It is
+   * kept unless it alone exceeds the budget of its shard.
+   */
+  void put(const KEY &key, const VAT_HANDLE &h, const SUP &sup,
+           const double &cost) {
+    unsigned long int bytes = h->byte_size() + sizeof(VAT);
+    shard &s = get_shard(key);
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (bytes > s.budget || s.entries.find(key) != s.entries.end())
+      return;
+    while (s.bytes + bytes > s.budget)
+      evict(s);
+
+    typename MAP::iterator it =
+        s.entries.insert(std::make_pair(key, entry())).first;
+    entry &e = it->second;
+    e.vat = h;
+    e.sup = sup;
+    e.bytes = bytes;
+    e.worth = cost / bytes;
+    e.pos = s.order.insert(std::make_pair(s.age + e.worth, &it->first));
+    s.bytes += bytes;
+  }
+
+  unsigned long hits() const { return _hits.load(std::memory_order_relaxed); }
+  unsigned long misses() const {
+    return _misses.load(std::memory_order_relaxed);
+  }
+  unsigned long evictions() const {
+    return _evictions.load(std::memory_order_relaxed);
+  }
+
+  /** Bytes of the VATs held; not synchronized with concurrent puts */
+  unsigned long int bytes() const {
+    unsigned long int b = 0;
+    for (unsigned int i = 0; i < _shards.size(); i++) {
+      std::lock_guard<std::mutex> guard(_shards[i].lock);
+      b += _shards[i].bytes;
+    }
+    return b;
+  }
+
+private:
+  struct entry;
+  typedef std::unordered_map<KEY, entry, HASH> MAP;
+  // entries by worth; the key pointer stays valid while the entry is mapped
+  typedef std::multiset<std::pair<double, const KEY *>> ORDER;
+
+  struct entry {
+    VAT_HANDLE vat;
+    SUP sup;
+    unsigned long int bytes;
+    double worth; // cost / bytes
+    typename ORDER::iterator pos;
+  };
+
+  struct shard {
+    shard() : budget(0), bytes(0), age(0) {}
+    mutable std::mutex lock;
+    MAP entries;
+    ORDER order;
+    unsigned long int budget;
+    unsigned long int bytes;
+    double age; // L, the worth of the last entry evicted
+  };
+
+  void evict(shard &s) {
+    typename ORDER::iterator least = s.order.begin();
+    s.age = least->first;
+    typename MAP::iterator it = s.entries.find(*least->second);
+    s.bytes -= it->second.bytes;
+    s.order.erase(least);
+    s.entries.erase(it); // drops the cache's reference to the VAT
+    _evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  shard &get_shard(const KEY &key) {
+    return _shards[HASH()(key) % _shards.size()];
+  }
+
+  std::vector<shard> _shards;
+  std::atomic<unsigned long> _hits;
+  std::atomic<unsigned long> _misses;
+  std::atomic<unsigned long> _evictions;
+
+}; // end class vat_cache
+
+#endif
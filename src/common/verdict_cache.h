@@ -0,0 +1,150 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file verdict_cache.h - process-wide cache of the support verdicts of
+ * candidate patterns */
+#ifndef _VERDICT_CACHE_H
+#define _VERDICT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * \brief Bounded, lock-free table of frequent/infrequent verdicts, keyed by
+ * the 128-bit fingerprint of a candidate's canonical code (see
+ * code_key::finish()).
+ *
+ * The table is direct mapped: a verdict goes to the slot picked by its
+ * fingerprint and replaces whatever was there, so memory stays at 16 bytes
+ * a slot however many candidates the walks evaluate. A slot is two words,
+ * the first fingerprint word and the second with its two low bits replaced
+ * by the verdict; they are written and read without locks, and a torn slot
+ * can only ever read as unknown.
+ *
+ * The optional Bloom filter in front (one byte a slot, three probes) answers
+ * for candidates never recorded without touching the larger table. Once as
+ * many verdicts were inserted as there are slots, most of those it was set
+ * for have been replaced, so it is cleared and starts over rather than
+ * saturating; a verdict still in the table then reads as unknown until it
+ * is inserted again.
+ */
+class verdict_cache {
+public:
+  enum verdict { UNKNOWN = 0, INFREQUENT = 1, FREQUENT = 2 };
+
+  /** A table of 2^log2_slots slots, with a Bloom filter if bloom is set */
+  verdict_cache(const unsigned int &log2_slots, const bool &bloom)
+      : _mask(((uint64_t)1 << log2_slots) - 1), _bloom_bits(0), _bloom(0),
+        _inserts(0), _lookups(0), _hits(0) {
+    _slots = new slot[_mask + 1];
+    if (bloom) {
+      _bloom_bits = (_mask + 1) * 8;
+      _bloom = new std::atomic<uint64_t>[_bloom_bits / 64];
+      for (uint64_t w = 0; w < _bloom_bits / 64; w++)
+        _bloom[w].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ~verdict_cache() {
+    delete[] _slots;
+    delete[] _bloom;
+  }
+
+  /** Verdict recorded for the fingerprint fp, or UNKNOWN */
+  verdict find(const uint64_t *fp) {
+    _lookups.fetch_add(1, std::memory_order_relaxed);
+    if (_bloom && !maybe_seen(fp))
+      return UNKNOWN;
+    const slot &s = _slots[fp[1] & _mask];
+    uint64_t b = s.b.load(std::memory_order_acquire);
+    if (s.a.load(std::memory_order_relaxed) != fp[0] ||
+        (b & ~(uint64_t)3) != (fp[1] & ~(uint64_t)3))
+      return UNKNOWN;
+    verdict v = (verdict)(b & 3);
+    if (v != UNKNOWN)
+      _hits.fetch_add(1, std::memory_order_relaxed);
+    return v;
+  }
+
+  /** Records whether the candidate with fingerprint fp is frequent */
+  void insert(const uint64_t *fp, const bool &frequent) {
+    slot &s = _slots[fp[1] & _mask];
+    s.a.store(fp[0], std::memory_order_relaxed);
+    s.b.store((fp[1] & ~(uint64_t)3) | (frequent ? FREQUENT : INFREQUENT),
+              std::memory_order_release);
+    if (_bloom) {
+      if ((_inserts.fetch_add(1, std::memory_order_relaxed) & _mask) == _mask)
+        clear_bloom();
+      for (unsigned int k = 0; k < 3; k++) {
+        uint64_t bit = probe(fp, k);
+        _bloom[bit / 64].fetch_or((uint64_t)1 << (bit % 64),
+                                  std::memory_order_relaxed);
+      }
+    }
+  }
+
+  unsigned long lookups() const {
+    return _lookups.load(std::memory_order_relaxed);
+  }
+
+  /** Lookups that found a verdict */
+  unsigned long hits() const { return _hits.load(std::memory_order_relaxed); }
+
+private:
+  struct slot {
+    slot() : a(0), b(0) {}
+    std::atomic<uint64_t> a; // fingerprint word 0
+    std::atomic<uint64_t> b; // fingerprint word 1, verdict in the low bits
+  };
+
+  // double hashing on the two fingerprint words
+  uint64_t probe(const uint64_t *fp, const unsigned int &k) const {
+    return (fp[0] + k * (fp[1] | 1)) % _bloom_bits;
+  }
+
+  bool maybe_seen(const uint64_t *fp) const {
+    for (unsigned int k = 0; k < 3; k++) {
+      uint64_t bit = probe(fp, k);
+      if (!(_bloom[bit / 64].load(std::memory_order_relaxed) &
+            ((uint64_t)1 << (bit % 64))))
+        return false;
+    }
+    return true;
+  }
+
+  // bits set meanwhile by other threads may be lost, which only makes
+  // their verdicts read as unknown
+  void clear_bloom() {
+    for (uint64_t w = 0; w < _bloom_bits / 64; w++)
+      _bloom[w].store(0, std::memory_order_relaxed);
+  }
+
+  verdict_cache(const verdict_cache &) = delete;
+  verdict_cache &operator=(const verdict_cache &) = delete;
+
+  uint64_t _mask; // slots - 1
+  slot *_slots;
+  uint64_t _bloom_bits;
+  std::atomic<uint64_t> *_bloom;
+  std::atomic<uint64_t> _inserts; // verdicts inserted, for clearing _bloom
+  std::atomic<unsigned long> _lookups;
+  std::atomic<unsigned long> _hits;
+
+}; // end class verdict_cache
+
+#endif
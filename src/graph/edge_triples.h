@@ -0,0 +1,110 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file edge_triples.h - dense ids of the frequent edge label triples */
+#ifndef _EDGE_TRIPLES_H
+#define _EDGE_TRIPLES_H
+
+#include "hash_utils.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \brief Dense integer ids of the frequent single-edge patterns, as
+ * (smaller vertex label, larger vertex label, edge label) triples.
+ *
+ * Ids run from 0 to size() - 1, in the order of the level-one patterns, so
+ * that the per-walk bookkeeping keyed by edge labels (edge_counter,
+ * failed_map) is plain arrays. Each triple also carries its limit: the most
+ * times it occurs in a single transaction, from the edge frequency map the
+ * tokenizer fills, and 1 for triples not in that map.
+ *
+ * Filled once after the database is loaded (add_patterns()) and only read
+ * by the walks.
+ */
+template <typename V_T, typename E_T> class edge_triples {
+public:
+  typedef pair<pair<V_T, V_T>, E_T> TRIPLE;
+
+  /**
+   * Numbers the single-edge patterns of level_one, in order, and takes the
+   * limits of their triples from edge_freq, a map from TRIPLE to the most
+   * occurrences in a transaction.
+   */
+  template <class PATS, class FREQ_MAP>
+  void add_patterns(const PATS &level_one, const FREQ_MAP &edge_freq) {
+    for (typename PATS::const_iterator it = level_one.begin();
+         it != level_one.end(); it++) {
+      E_T e;
+      if (!(*it)->get_out_edge(0, 1, e)) {
+        cerr << "edge_triples: edge not found" << endl;
+        exit(1);
+      }
+      TRIPLE t = make_triple((*it)->label(0), (*it)->label(1), e);
+      if (_ids.find(t) != _ids.end())
+        continue;
+      typename FREQ_MAP::const_iterator f = edge_freq.find(t);
+      _ids.insert(make_pair(t, (int)_triples.size()));
+      _triples.push_back(t);
+      _limits.push_back(f == edge_freq.end() ? 1 : f->second);
+    }
+  }
+
+  unsigned int size() const { return _triples.size(); }
+
+  /** Id of the edge labelled e between labels a and b, in either order, or
+   * -1 if it is not frequent */
+  int id(const V_T &a, const V_T &b, const E_T &e) const {
+    typename IDS::const_iterator it = _ids.find(make_triple(a, b, e));
+    return it == _ids.end() ? -1 : it->second;
+  }
+
+  const TRIPLE &triple(const int &id) const { return _triples[id]; }
+
+  /** Most times the triple id occurs in a single transaction */
+  int limit(const int &id) const { return _limits[id]; }
+
+  static TRIPLE make_triple(const V_T &a, const V_T &b, const E_T &e) {
+    if (a < b)
+      return make_pair(make_pair(a, b), e);
+    return make_pair(make_pair(b, a), e);
+  }
+
+private:
+  struct triple_hash {
+    size_t operator()(const TRIPLE &t) const {
+      size_t h = myhash<V_T>()(t.first.first);
+      h = h * 0x100000001b3ULL ^ myhash<V_T>()(t.first.second);
+      return h * 0x100000001b3ULL ^ myhash<E_T>()(t.second);
+    }
+  };
+
+  typedef unordered_map<TRIPLE, int, triple_hash> IDS;
+
+  IDS _ids;
+  vector<TRIPLE> _triples; // by id
+  vector<int> _limits;     // by id
+
+}; // end class edge_triples
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _EMBEDDING_SET_H
+#define _EMBEDDING_SET_H
+
+#include "hash_utils.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Set of embeddings of one transaction, used by the graph VAT
+ * intersections to drop duplicate embeddings.
+ *
+ * An embedding is identified by its edge set, written as a sorted flat array
+ * of vertex-id pairs. All embeddings of a candidate pattern have the same
+ * number of edges, so keys have a fixed stride and are stored back to back in
+ * one buffer. Lookups go through an open-addressing table of FNV-1a hashes;
+ * on a hash match the flat keys are compared, so two different edge sets are
+ * never merged. The table only grows, and the slots taken are listed, so
+ * that reset() clears those alone rather than the whole table.
+ */
+class embedding_set {
+public:
+  embedding_set() : _stride(0), _size(0) {}
+
+  /** Empties the set, keys inserted afterwards are stride ints long */
+  void reset(const unsigned int &stride) {
+    _stride = stride;
+    _size = 0;
+    _keys.clear();
+    if (_slots.size() < MIN_SLOTS) {
+      _slots.assign(MIN_SLOTS, 0);
+      _hashes.assign(MIN_SLOTS, 0);
+    } else {
+      for (size_t k = 0; k < _used.size(); k++)
+        _slots[_used[k]] = 0;
+    }
+    _used.clear();
+  }
+
+  /**
+   * Builds the key of the edge set es extended by new_edge, in the order
+   * used by the VAT edge sets (ltpair). es must already be sorted that way
+   * and must not hold new_edge. The key is left in key().
+   */
+  template <class E_SET>
+  void make_key(const E_SET &es, const std::pair<int, int> &new_edge) {
+    _key.resize(2 * (es.size() + 1));
+    int *k = _key.data();
+    bool placed = false;
+    typename E_SET::const_iterator it;
+    for (it = es.begin(); it != es.end(); it++) {
+      if (!placed && new_edge < *it) {
+        *k++ = new_edge.first;
+        *k++ = new_edge.second;
+        placed = true;
+      }
+      *k++ = it->first;
+      *k++ = it->second;
+    }
+    if (!placed) {
+      *k++ = new_edge.first;
+      *k++ = new_edge.second;
+    }
+  }
+
+  const std::vector<int> &key() const { return _key; }
+
+  /** Inserts the key built by the last make_key(); returns false if an
+   * identical key is already present */
+  bool insert_key() { return insert(_key.data()); }
+
+  /** Inserts a key of stride ints; returns false if it is already present */
+  bool insert(const int *key) {
+    if (2 * (_size + 1) > _slots.size())
+      grow();
+
+    uint64_t h = hash_key(key);
+    size_t mask = _slots.size() - 1;
+    size_t pos = h & mask;
+    while (_slots[pos]) {
+      if (_hashes[pos] == h &&
+          !memcmp(key_at(_slots[pos] - 1), key, _stride * sizeof(int)))
+        return false;
+      pos = (pos + 1) & mask;
+    }
+    _keys.insert(_keys.end(), key, key + _stride);
+    _size++;
+    _slots[pos] = _size;
+    _hashes[pos] = h;
+    _used.push_back(pos);
+    return true;
+  }
+
+  unsigned int size() const { return _size; }
+
+private:
+  static const size_t MIN_SLOTS = 64; // power of two
+
+  uint64_t hash_key(const int *key) const {
+    fnv1a_64 hashfn;
+    hashfn.update(key, _stride * sizeof(int));
+    return hashfn.digest();
+  }
+
+  const int *key_at(const unsigned int &idx) const {
+    return _keys.data() + (size_t)idx * _stride;
+  }
+
+  void grow() {
+    std::vector<unsigned int> slots(2 * _slots.size(), 0);
+    std::vector<uint64_t> hashes(2 * _slots.size(), 0);
+    size_t mask = slots.size() - 1;
+    for (size_t k = 0; k < _used.size(); k++) {
+      size_t i = _used[k];
+      size_t pos = _hashes[i] & mask;
+      while (slots[pos])
+        pos = (pos + 1) & mask;
+      slots[pos] = _slots[i];
+      hashes[pos] = _hashes[i];
+      _used[k] = pos;
+    }
+    _slots.swap(slots);
+    _hashes.swap(hashes);
+  }
+
+  unsigned int _stride;
+  unsigned int _size;
+  std::vector<int> _keys;          // all keys, stride ints each
+  std::vector<unsigned int> _slots; // 1 + index of the key, 0 if empty
+  std::vector<uint64_t> _hashes;    // hash of the key in the same slot
+  std::vector<size_t> _used;        // slots taken since reset()
+  std::vector<int> _key;            // scratch key of make_key()
+
+}; // end class embedding_set
+
+#endif
@@ -0,0 +1,540 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _GRAPH_ARENA_VAT_H
+#define _GRAPH_ARENA_VAT_H
+
+#include "bump_arena.h"
+#include "embedding_set.h"
+#include "generic_classes.h"
+#include "graph_vat.h"
+#include "helper_funs.h"
+#include "incidence_index.h"
+#include "tid_bitset.h"
+#include "typedefs.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+template <typename PP, typename MP>
+class vat<GRAPH_PROP, V_Fk1_MINE_PROP, arena_storage>;
+
+template <typename PP, typename MP>
+ostream &operator<<(ostream &ostr,
+                    const vat<GRAPH_PROP, V_Fk1_MINE_PROP, arena_storage> *v);
+
+/**
+ * \brief Graph VAT class with a packed layout, selected by passing
+ * arena_storage as the ST argument.
+ *
+ * Holds the same data as the std::vector graph VAT, but every embedding is
+ * one fixed-stride row of ints: the ids of the pattern's vertices, followed by
+ * the pattern's edges as (vid, vid) pairs sorted as in the E_SET of the vector
+ * VAT. All embeddings of one tid form a contiguous block, allocated from a bump
+ * arena owned by the VAT, so intersections scan plain memory and copying an
+ * embedding is a memcpy. The tids are also kept in a tid_bitset, from which
+ * intersection() counts and finds the common tids without reading the blocks.
+ *
+ * Level-one VATs also index their rows by end vertex (incidence_index), so
+ * that an intersection looks up the edges at a vertex of an embedding
+ * instead of scanning every edge of the transaction.
+ */
+template <typename PP, typename MP>
+class vat<GRAPH_PROP, V_Fk1_MINE_PROP, arena_storage> {
+public:
+  typedef vat<GRAPH_PROP, V_Fk1_MINE_PROP, arena_storage> VAT;
+
+  /** Embeddings of a pattern in one transaction */
+  struct tid_block {
+    int tid;
+    unsigned int count; // number of rows
+    unsigned int cap;   // rows reserved in the arena
+    int *rows;
+  };
+
+  typedef vector<tid_block> BLOCKS;
+  typedef typename BLOCKS::const_iterator CONST_IT;
+
+  vat() : _nv(0), _ne(0), _stride(0) {}
+
+  void *operator new(size_t size) {
+    metrics::add(metrics::VAT_ALLOC);
+    return alloc_bytes<ALLOC>(size);
+  }
+
+  void operator delete(void *p, size_t size) { free_bytes<ALLOC>(p, size); }
+
+  CONST_IT begin() const { return _blocks.begin(); }
+  CONST_IT end() const { return _blocks.end(); }
+
+  friend ostream &operator<< <>(ostream &, const VAT *);
+
+  int size() const { return _blocks.size(); }
+
+  bool empty() const { return _blocks.empty(); }
+
+  /** Tid of the last transaction in the VAT */
+  int last_tid() const { return _blocks.back().tid; }
+
+  const tid_bitset &tids() const { return _tids; }
+
+  /** Number of vertices and edges of each embedding */
+  unsigned int num_vertices() const { return _nv; }
+  unsigned int num_edges() const { return _ne; }
+
+  /** Row of the idx-th embedding in block b; the vertex ids come first,
+   * then the edges */
+  const int *row(const tid_block &b, const unsigned int &idx) const {
+    return b.rows + (size_t)idx * _stride;
+  }
+
+  /**
+   * Adds an embedding of a single-edge pattern, for the edge (vid1, vid2) of
+   * transaction tid. Only used from graph_tokenizer.h, while building the
+   * level-one VATs.
+   */
+  void insert_edge(const int &tid, const int &vid1, const int &vid2) {
+    if (!_stride)
+      set_shape(2, 1);
+    int *r = append_row(tid);
+    r[0] = vid1;
+    r[1] = vid2;
+    r[2] = vid1;
+    r[3] = vid2;
+    _inc.add(_blocks.size() - 1, vid1, vid2, _blocks.back().count - 1);
+  }
+
+  /**
+   * Completes the VAT once all its embeddings are inserted; done by db_reader
+   * for every level-one VAT it keeps, before any is intersected.
+   */
+  void finish() { _inc.finish(); }
+
+  /**
+   * Moves the embeddings of other to the end of this VAT; the tids of other
+   * must not be smaller than the last tid here. The blocks of other are not
+   * copied, this VAT takes over its arena.
+   */
+  void append(VAT &other) {
+    if (other._blocks.empty())
+      return;
+    if (!_stride)
+      set_shape(other._nv, other._ne);
+
+    typename BLOCKS::iterator it = other._blocks.begin();
+    bool merge = !_blocks.empty() && _blocks.back().tid == it->tid;
+    _inc.append(other._inc, merge, merge ? _blocks.back().count : 0);
+    if (merge) { // same tid
+      for (unsigned int i = 0; i < it->count; i++)
+        memcpy(append_row(it->tid), other.row(*it, i), _stride * sizeof(int));
+      it++;
+    }
+    for (typename BLOCKS::iterator b = it; b != other._blocks.end(); b++)
+      _tids.push_back(b->tid);
+    _blocks.insert(_blocks.end(), it, other._blocks.end());
+    _arena.adopt(other._arena);
+    other._blocks.clear();
+    other._tids.clear();
+  }
+
+  /**
+   * Print the tids for the vat.
+   */
+  void print_tids() {
+    for (CONST_IT it = begin(); it != end(); it++) {
+      if (it == begin())
+        cout << it->tid;
+      else
+        cout << ", " << it->tid;
+    }
+    cout << endl;
+  }
+
+  /**
+   * get the tids for the vat.
+   */
+  void get_tids(vector<unsigned int> &tids) {
+    for (CONST_IT it = begin(); it != end(); it++)
+      tids.push_back(it->tid);
+  }
+
+  /**
+   * Calls f(tid, vids) for every embedding, in tid order; vids points to the
+   * ids of the vertices of the embedding, one per pattern vertex.
+   */
+  template <typename FUNC> void for_each_embedding(FUNC f) const {
+    for (CONST_IT it = begin(); it != end(); it++)
+      for (unsigned int i = 0; i < it->count; i++)
+        f(it->tid, row(*it, i));
+  }
+
+  /**
+   * Jaccard distance between the tid lists of two VATs.
+   */
+  static double get_tid_distance(const VAT *v1, const VAT *v2) {
+    unsigned int intersection_size =
+        tid_bitset::count_common(v1->_tids, v2->_tids);
+    unsigned int union_size = v1->size() + v2->size() - intersection_size;
+    return 1.0 - (double)intersection_size / union_size;
+  }
+
+  /** Main vat intersection function; It also populates support argument passed
+   */
+  // NOTE: only one candidate is generated in a FkxF1 join of graphs,
+  // hence only the first value in cand_pats should be inspected
+  template <typename PATTERN, typename PAT_SUP>
+  static VAT **intersection(const VAT *v1, const VAT *v2, PAT_SUP **cand_sups,
+                            PATTERN **cand_pats, bool isfwd,
+                            const pair<int, int> &vids, const int &minsup) {
+
+    // Count the common tids on the bitsets. If the count is less than
+    // min_sup, then no need to even go through fwd and back intersects.
+    if ((int)tid_bitset::count_common(v1->_tids, v2->_tids) < minsup)
+      return NULL;
+
+    VAT *cand_vat = new VAT;
+    VAT **cand_vats = new VAT *;
+    cand_vats[0] = cand_vat;
+    cand_vat->set_shape(v1->_nv + (isfwd ? 1 : 0), v1->_ne + 1);
+
+    // the ranks of a common tid are the indices of its blocks
+    const tid_block *b1 = v1->_blocks.data();
+    if (isfwd)
+      tid_bitset::for_common(
+          v1->_tids, v2->_tids,
+          [&](unsigned int, unsigned int i1, unsigned int i2) {
+            fwd_intersect(v1, b1[i1], v2, i2, vids, cand_vat);
+          });
+    else
+      tid_bitset::for_common(
+          v1->_tids, v2->_tids,
+          [&](unsigned int, unsigned int i1, unsigned int i2) {
+            back_intersect(v1, b1[i1], v2, i2, vids, cand_vat);
+          });
+
+    cand_sups[0]->set_sup(make_pair(cand_vat->size(), 0));
+    return cand_vats;
+  } // end intersect()
+
+  /**
+   * Batched intersection: the num candidates cand_pats all add the edge of
+   * v2 at pattern vertex src, candidate c leading to pattern vertex dests[c],
+   * or to a new vertex when dests[c] is the number of vertices of v1. Null
+   * candidates are skipped. All candidates are built in a single pass over
+   * the embeddings of v1; returns their num VATs, or NULL when all are null
+   * or the tids leave none of them frequent.
+   */
+  template <typename PATTERN, typename PAT_SUP>
+  static VAT **intersection(const VAT *v1, const VAT *v2, PAT_SUP **cand_sups,
+                            PATTERN **cand_pats, const int &num,
+                            const int &src, const int *dests,
+                            const int &minsup) {
+    if (std::count(cand_pats, cand_pats + num, (PATTERN *)0) == num ||
+        (int)tid_bitset::count_common(v1->_tids, v2->_tids) < minsup)
+      return NULL;
+
+    // candidate of each vertex an edge may lead to, a new vertex last
+    static thread_local vector<int> cand_at;
+    cand_at.assign(v1->_nv + 1, -1);
+    VAT **cand_vats = new VAT *[num];
+    for (int c = 0; c < num; c++) {
+      cand_vats[c] = 0;
+      if (!cand_pats[c])
+        continue;
+      cand_vats[c] = new VAT;
+      cand_vats[c]->set_shape(v1->_nv + (dests[c] == (int)v1->_nv ? 1 : 0),
+                              v1->_ne + 1);
+      cand_at[dests[c]] = c;
+    }
+
+    const tid_block *b1 = v1->_blocks.data();
+    tid_bitset::for_common(
+        v1->_tids, v2->_tids,
+        [&](unsigned int, unsigned int i1, unsigned int i2) {
+          multi_intersect(v1, b1[i1], v2, i2, src, cand_at, cand_vats);
+        });
+
+    for (int c = 0; c < num; c++)
+      if (cand_pats[c])
+        cand_sups[c]->set_sup(make_pair(cand_vats[c]->size(), 0));
+    return cand_vats;
+  } // end intersect()
+
+  /**
+   * For a given transaction, extends every embedding of v1 by a single-edge
+   * embedding of v2 (in its block i2) that starts at the vertex
+   * edge_vids.first and leads to a vertex not yet in the embedding.
+   */
+  void static fwd_intersect(const VAT *v1, const tid_block &b1, const VAT *v2,
+                            const unsigned int &i2,
+                            const pair<int, int> &edge_vids, VAT *c_vat) {
+
+    const tid_block &b2 = v2->_blocks[i2];
+
+    const unsigned int nv = v1->_nv;
+    const unsigned int ne = v1->_ne;
+
+    // Keeps the edge set of each embedding added for this tid.
+    static thread_local embedding_set edge_set_map;
+    edge_set_map.reset(2 * (ne + 1));
+
+    for (unsigned int i = 0; i < b1.count; i++) {
+      const int *r1 = v1->row(b1, i);
+      const int *vs1_end = r1 + nv;
+      int mapped_v = r1[edge_vids.first];
+
+      // the edges of v2 at mapped_v
+      pair<incidence_index::CONST_IT, incidence_index::CONST_IT> at =
+          v2->_inc.find(i2, mapped_v);
+      for (incidence_index::CONST_IT e = at.first; e != at.second; e++) {
+        const int *r2 = v2->row(b2, e->second);
+        int other_v = r2[0] == mapped_v ? r2[1] : r2[0];
+
+        // The edge must lead to a vertex outside of the embedding.
+        if (find(r1, vs1_end, other_v) != vs1_end)
+          continue;
+
+        int *c = c_vat->append_row(b2.tid);
+        memcpy(c, r1, nv * sizeof(int));
+        c[nv] = other_v;
+        merge_edge(r1 + nv, ne, make_pair(mapped_v, other_v), c + nv + 1);
+
+        if (!edge_set_map.insert(c + nv + 1))
+          c_vat->drop_last_row(); // this embedding was already added
+      }
+    }
+  }
+
+  /**
+   * For a given transaction, adds to every embedding of v1 the edge between
+   * its vertices edge_vids.first and edge_vids.second, where the transaction
+   * has that edge (in block i2 of v2) and the embedding does not use it yet.
+   */
+  void static back_intersect(const VAT *v1, const tid_block &b1, const VAT *v2,
+                             const unsigned int &i2,
+                             const pair<int, int> &edge_vids, VAT *c_vat) {
+
+    const tid_block &b2 = v2->_blocks[i2];
+
+    const unsigned int nv = v1->_nv;
+    const unsigned int ne = v1->_ne;
+
+    // Keeps the edge set of each embedding added for this tid.
+    static thread_local embedding_set edge_set_map;
+    edge_set_map.reset(2 * (ne + 1));
+
+    for (unsigned int i = 0; i < b1.count; i++) {
+      const int *r1 = v1->row(b1, i);
+      int mapped_vid1 = r1[edge_vids.first];
+      int mapped_vid2 = r1[edge_vids.second];
+
+      pair<incidence_index::CONST_IT, incidence_index::CONST_IT> at =
+          v2->_inc.find(i2, mapped_vid1);
+      for (incidence_index::CONST_IT e = at.first; e != at.second; e++) {
+        const int *r2 = v2->row(b2, e->second);
+
+        if ((r2[0] == mapped_vid1 ? r2[1] : r2[0]) != mapped_vid2)
+          continue;
+
+        if (has_edge(r1 + nv, ne, mapped_vid1, mapped_vid2))
+          continue;
+
+        int *c = c_vat->append_row(b2.tid);
+        memcpy(c, r1, nv * sizeof(int));
+        merge_edge(r1 + nv, ne, make_pair(mapped_vid1, mapped_vid2), c + nv);
+
+        if (!edge_set_map.insert(c + nv))
+          c_vat->drop_last_row(); // this embedding was already added
+      }
+    }
+  }
+
+  /**
+   * For a given transaction, extends every embedding of v1 by each
+   * single-edge embedding of v2 (in its block i2) that starts at the vertex
+   * src, adding the result to the VAT of the candidate for the vertex the
+   * edge leads to (cand_at, see the batched intersection()). Each candidate
+   * gets the rows fwd_intersect() or back_intersect() would give it.
+   */
+  void static multi_intersect(const VAT *v1, const tid_block &b1,
+                              const VAT *v2, const unsigned int &i2,
+                              const int &src, const vector<int> &cand_at,
+                              VAT **c_vats) {
+
+    const tid_block &b2 = v2->_blocks[i2];
+
+    const unsigned int nv = v1->_nv;
+    const unsigned int ne = v1->_ne;
+
+    // Keeps the edge set of each embedding added for this tid, by candidate.
+    static thread_local vector<embedding_set> edge_set_maps;
+    if (edge_set_maps.size() < nv + 1)
+      edge_set_maps.resize(nv + 1);
+    for (unsigned int d = 0; d <= nv; d++)
+      if (cand_at[d] >= 0)
+        edge_set_maps[d].reset(2 * (ne + 1));
+
+    for (unsigned int i = 0; i < b1.count; i++) {
+      const int *r1 = v1->row(b1, i);
+      int mapped_v = r1[src];
+
+      pair<incidence_index::CONST_IT, incidence_index::CONST_IT> at =
+          v2->_inc.find(i2, mapped_v);
+      for (incidence_index::CONST_IT e = at.first; e != at.second; e++) {
+        const int *r2 = v2->row(b2, e->second);
+        int other_v = r2[0] == mapped_v ? r2[1] : r2[0];
+
+        unsigned int d = find(r1, r1 + nv, other_v) - r1; // nv if new
+        if (cand_at[d] < 0)
+          continue;
+        if (d < nv && has_edge(r1 + nv, ne, mapped_v, other_v))
+          continue;
+
+        VAT *c_vat = c_vats[cand_at[d]];
+        int *c = c_vat->append_row(b2.tid);
+        memcpy(c, r1, nv * sizeof(int));
+        int *es = c + nv;
+        if (d == nv)
+          *es++ = other_v;
+        merge_edge(r1 + nv, ne, make_pair(mapped_v, other_v), es);
+
+        if (!edge_set_maps[d].insert(es))
+          c_vat->drop_last_row(); // this embedding was already added
+      }
+    }
+  }
+
+  /** Bytes taken by the rows reserved for the embeddings, the blocks, the
+   * tid bitset and the incidence index, not counting unused arena space */
+  unsigned long int byte_size() const {
+    unsigned long int sz = _blocks.capacity() * sizeof(tid_block);
+    for (CONST_IT it = begin(); it != end(); it++)
+      sz += (unsigned long int)it->cap * _stride * sizeof(int);
+    return sz + _tids.byte_size() + _inc.byte_size();
+  }
+
+private:
+  void set_shape(const unsigned int &nv, const unsigned int &ne) {
+    _nv = nv;
+    _ne = ne;
+    _stride = nv + 2 * ne;
+  }
+
+  /** Returns a new row at the end of the block of tid, which must be the last
+   * block or a new one */
+  int *append_row(const int &tid) {
+    if (_blocks.empty() || _blocks.back().tid != tid) {
+      tid_block b;
+      b.tid = tid;
+      _tids.push_back(tid);
+      b.count = 0;
+      b.cap = 4;
+      b.rows = _arena.allocate((size_t)b.cap * _stride);
+      _blocks.push_back(b);
+    }
+
+    tid_block &b = _blocks.back();
+    if (b.count == b.cap) {
+      b.rows = _arena.extend(b.rows, (size_t)b.cap * _stride,
+                             (size_t)2 * b.cap * _stride);
+      b.cap *= 2;
+    }
+    return b.rows + (size_t)(b.count++) * _stride;
+  }
+
+  /** Takes back the last row appended; an emptied block is dropped */
+  void drop_last_row() {
+    if (--_blocks.back().count == 0) {
+      _tids.pop_back(_blocks.back().tid);
+      _blocks.pop_back();
+    }
+  }
+
+  /** Writes the ne sorted edges es with e merged in at its place to out */
+  static void merge_edge(const int *es, const unsigned int &ne,
+                         const pair<int, int> &e, int *out) {
+    unsigned int k = 0;
+    while (k < ne && make_pair(es[2 * k], es[2 * k + 1]) < e) {
+      out[2 * k] = es[2 * k];
+      out[2 * k + 1] = es[2 * k + 1];
+      k++;
+    }
+    out[2 * k] = e.first;
+    out[2 * k + 1] = e.second;
+    memcpy(out + 2 * k + 2, es + 2 * k, 2 * (ne - k) * sizeof(int));
+  }
+
+  /** True if the edge a-b, in either direction, is among the ne edges es */
+  static bool has_edge(const int *es, const unsigned int &ne, const int &a,
+                       const int &b) {
+    for (unsigned int k = 0; k < ne; k++)
+      if ((es[2 * k] == a && es[2 * k + 1] == b) ||
+          (es[2 * k] == b && es[2 * k + 1] == a))
+        return true;
+    return false;
+  }
+
+  unsigned int _nv;     // vertices per embedding
+  unsigned int _ne;     // edges per embedding
+  unsigned int _stride; // ints per row, _nv + 2*_ne
+  BLOCKS _blocks;       // one block per tid, in tid order
+  tid_bitset _tids;     // tids of _blocks
+  incidence_index _inc; // level one only: rows by end vertex
+  bump_arena<int> _arena;
+
+}; // end class vat for graphs, arena layout
+
+/**
+ * Output the VAT object, in the same format as the std::vector graph VAT
+ */
+template <typename PP, typename MP>
+ostream &operator<<(ostream &ostr,
+                    const vat<GRAPH_PROP, V_Fk1_MINE_PROP, arena_storage> *v) {
+  typedef vat<GRAPH_PROP, V_Fk1_MINE_PROP, arena_storage> VAT;
+
+  cout << "***** Printing candidate patterns vat." << endl;
+  for (typename VAT::CONST_IT it = v->begin(); it != v->end(); it++) {
+    cout << "Tid = " << it->tid << endl;
+
+    for (unsigned int i = 0; i < it->count; i++) {
+      const int *r = v->row(*it, i);
+
+      cout << "[";
+      for (unsigned int w = 0; w < v->_nv; w++) {
+        if (w != 0)
+          cout << ";" << r[w];
+        else
+          cout << r[w];
+      }
+      cout << "]\t[";
+
+      const int *es = r + v->_nv;
+      for (unsigned int k = 0; k < v->_ne; k++) {
+        if (k != 0)
+          cout << ";";
+        cout << "(" << es[2 * k] << "-->" << es[2 * k + 1] << ")";
+      }
+      cout << "]\n";
+    }
+  }
+  cout << "***** Finished printing candidate patterns vat." << endl;
+
+  return ostr;
+} // operator<< for vat*
+
+#endif
@@ -0,0 +1,321 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file graph_bin_format.h - binary graph database format, see
+ * graph_to_bin.cpp for the converter from the ASCII format */
+#ifndef _GRAPH_BIN_FORMAT_H
+#define _GRAPH_BIN_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Layout of a binary graph database, all integers in host byte order:
+ *
+ *   header      graph_bin_header
+ *   data        one record per transaction, in input order
+ *   index       uint64 offset of each record
+ *   dictionary  vertex labels then edge labels, each a uint32 length followed
+ *               by the label text, padded to 4 bytes
+ *
+ * A transaction record holds tid, nv, ne and then the arrays
+ *   int32  vids[nv]          vertex ids of the input file
+ *   uint32 vlbls[nv]         vertex label ids
+ *   uint32 edges[3*ne]       (src, dest, edge label id) in input order, src
+ *                            and dest being vertex positions in the record
+ *   uint32 row_ptr[nv+1]     CSR adjacency: the neighbours of vertex i are
+ *   uint32 adj[2*2*ne]       the (vertex, edge index) pairs between
+ *                            adj[2*row_ptr[i]] and adj[2*row_ptr[i+1]]
+ * Labels are kept as text, so they can be parsed into any label type.
+ */
+
+#define GRAPH_BIN_MAGIC "DMTLGRB1"
+#define GRAPH_BIN_VERSION 1
+
+struct graph_bin_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_trans;
+  uint32_t num_vlabels;
+  uint32_t num_elabels;
+  uint64_t data_off;
+  uint64_t index_off;
+  uint64_t dict_off;
+  uint64_t file_size;
+};
+
+/**
+ * \brief Read-only view of a binary graph database held in memory, typically
+ * a mapped_file.
+ */
+class graph_bin_db {
+public:
+  /** One transaction graph; the pointers point into the database */
+  struct trans {
+    int tid;
+    uint32_t nv, ne;
+    const int32_t *vids;
+    const uint32_t *vlbls;
+    const uint32_t *edges;
+    const uint32_t *row_ptr;
+    const uint32_t *adj;
+  };
+
+  graph_bin_db() : _data(0), _size(0), _hdr(0), _index(0) {}
+
+  /** True if data starts like a binary graph database */
+  static bool is_bin(const char *data, const size_t &size) {
+    return size >= sizeof(graph_bin_header) &&
+           !memcmp(data, GRAPH_BIN_MAGIC, 8);
+  }
+
+  /** Checks the header and reads the label dictionaries; returns false and
+   * prints the reason if the database is not usable */
+  bool open(const char *data, const size_t &size) {
+    _data = data;
+    _size = size;
+    if (!is_bin(data, size)) {
+      cerr << "graph_bin_db: not a binary graph database" << endl;
+      return false;
+    }
+
+    _hdr = reinterpret_cast<const graph_bin_header *>(data);
+    if (_hdr->version != GRAPH_BIN_VERSION) {
+      cerr << "graph_bin_db: unsupported version " << _hdr->version << endl;
+      return false;
+    }
+    if (_hdr->file_size != size || _hdr->data_off > _hdr->index_off ||
+        _hdr->index_off + 8 * (uint64_t)_hdr->num_trans > _hdr->dict_off ||
+        _hdr->dict_off > size) {
+      cerr << "graph_bin_db: database is truncated or corrupt" << endl;
+      return false;
+    }
+    _index = reinterpret_cast<const uint64_t *>(data + _hdr->index_off);
+
+    uint64_t off = _hdr->dict_off;
+    if (!read_labels(off, _hdr->num_vlabels, _vlabels) ||
+        !read_labels(off, _hdr->num_elabels, _elabels)) {
+      cerr << "graph_bin_db: bad label dictionary" << endl;
+      return false;
+    }
+    return true;
+  }
+
+  uint32_t num_trans() const { return _hdr->num_trans; }
+  const vector<std::string> &vertex_labels() const { return _vlabels; }
+  const vector<std::string> &edge_labels() const { return _elabels; }
+
+  /** Fills t with the idx-th transaction; returns false if its record does
+   * not fit in the data section */
+  bool get_trans(const uint32_t &idx, trans &t) const {
+    uint64_t off = _index[idx];
+    if (off < _hdr->data_off || off + 12 > _hdr->index_off)
+      return false;
+
+    const uint32_t *p = reinterpret_cast<const uint32_t *>(_data + off);
+    t.tid = (int)p[0];
+    t.nv = p[1];
+    t.ne = p[2];
+    if (off + 4 * record_words(t.nv, t.ne) > _hdr->index_off)
+      return false;
+
+    p += 3;
+    t.vids = reinterpret_cast<const int32_t *>(p);
+    t.vlbls = p + t.nv;
+    t.edges = t.vlbls + t.nv;
+    t.row_ptr = t.edges + 3 * t.ne;
+    t.adj = t.row_ptr + t.nv + 1;
+    return true;
+  }
+
+  /** Number of uint32 words in a record with nv vertices and ne edges */
+  static uint64_t record_words(const uint64_t &nv, const uint64_t &ne) {
+    return 3 + 2 * nv + 3 * ne + (nv + 1) + 4 * ne;
+  }
+
+private:
+  bool read_labels(uint64_t &off, const uint32_t &n, vector<std::string> &lbls) {
+    lbls.clear();
+    lbls.reserve(n);
+    for (uint32_t i = 0; i < n; i++) {
+      if (off + 4 > _size)
+        return false;
+      uint32_t len;
+      memcpy(&len, _data + off, 4);
+      off += 4;
+      if (off + len > _size)
+        return false;
+      lbls.push_back(std::string(_data + off, len));
+      off += (len + 3) & ~3u;
+    }
+    return true;
+  }
+
+  const char *_data;
+  size_t _size;
+  const graph_bin_header *_hdr;
+  const uint64_t *_index;
+  vector<std::string> _vlabels;
+  vector<std::string> _elabels;
+
+}; // end class graph_bin_db
+
+/**
+ * \brief Writes a binary graph database one transaction at a time.
+ */
+class graph_bin_writer {
+public:
+  graph_bin_writer() {}
+  ~graph_bin_writer() { close(); }
+
+  bool open(const char *file_name) {
+    _out.open(file_name, ios::out | ios::binary | ios::trunc);
+    if (!_out.is_open())
+      return false;
+    graph_bin_header hdr;
+    memset(&hdr, 0, sizeof(hdr)); // rewritten by close()
+    _out.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    _offsets.clear();
+    return _out.good();
+  }
+
+  /** Dictionary id of a vertex label, assigned in order of first use */
+  uint32_t vertex_label_id(const std::string &lbl) {
+    return label_id(lbl, _vlbl_ids, _vlabels);
+  }
+
+  /** Dictionary id of an edge label, assigned in order of first use */
+  uint32_t edge_label_id(const std::string &lbl) {
+    return label_id(lbl, _elbl_ids, _elabels);
+  }
+
+  /**
+   * Appends a transaction. vids and vlbls describe its vertices; edges holds
+   * (src, dest, edge label id) triples, src and dest being positions in
+   * vids.
+   */
+  void add_trans(const int &tid, const vector<int32_t> &vids,
+                 const vector<uint32_t> &vlbls, const vector<uint32_t> &edges) {
+    uint32_t nv = vids.size(), ne = edges.size() / 3;
+
+    // CSR adjacency, neighbours listed in edge order
+    vector<uint32_t> row_ptr(nv + 1, 0);
+    for (uint32_t e = 0; e < ne; e++) {
+      row_ptr[edges[3 * e] + 1]++;
+      row_ptr[edges[3 * e + 1] + 1]++;
+    }
+    for (uint32_t v = 0; v < nv; v++)
+      row_ptr[v + 1] += row_ptr[v];
+
+    vector<uint32_t> fill(row_ptr.begin(), row_ptr.end() - 1);
+    vector<uint32_t> adj(4 * ne);
+    for (uint32_t e = 0; e < ne; e++) {
+      uint32_t src = edges[3 * e], dest = edges[3 * e + 1];
+      adj[2 * fill[src]] = dest;
+      adj[2 * fill[src]++ + 1] = e;
+      adj[2 * fill[dest]] = src;
+      adj[2 * fill[dest]++ + 1] = e;
+    }
+
+    _offsets.push_back(_out.tellp());
+    uint32_t head[3] = {(uint32_t)tid, nv, ne};
+    write(head, 3);
+    write(vids.data(), nv);
+    write(vlbls.data(), nv);
+    write(edges.data(), 3 * ne);
+    write(row_ptr.data(), nv + 1);
+    write(adj.data(), 4 * ne);
+  }
+
+  /** Writes the index, the dictionaries and the header; returns false on an
+   * I/O error */
+  bool close() {
+    if (!_out.is_open())
+      return true;
+
+    graph_bin_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, GRAPH_BIN_MAGIC, 8);
+    hdr.version = GRAPH_BIN_VERSION;
+    hdr.num_trans = _offsets.size();
+    hdr.num_vlabels = _vlabels.size();
+    hdr.num_elabels = _elabels.size();
+    hdr.data_off = sizeof(hdr);
+    if (_out.tellp() % 8) { // records are 4-byte aligned, the index 8
+      uint32_t zero = 0;
+      write(&zero, 1);
+    }
+    hdr.index_off = _out.tellp();
+    _out.write(reinterpret_cast<const char *>(_offsets.data()),
+               8 * _offsets.size());
+    hdr.dict_off = _out.tellp();
+    write_labels(_vlabels);
+    write_labels(_elabels);
+    hdr.file_size = _out.tellp();
+
+    _out.seekp(0);
+    _out.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    bool ok = _out.good();
+    _out.close();
+    return ok;
+  }
+
+  uint32_t num_trans() const { return _offsets.size(); }
+
+private:
+  template <typename T> void write(const T *p, const size_t &n) {
+    _out.write(reinterpret_cast<const char *>(p), n * sizeof(T));
+  }
+
+  uint32_t label_id(const std::string &lbl, map<std::string, uint32_t> &ids,
+                    vector<std::string> &lbls) {
+    map<std::string, uint32_t>::iterator it = ids.find(lbl);
+    if (it != ids.end())
+      return it->second;
+    ids.insert(make_pair(lbl, (uint32_t)lbls.size()));
+    lbls.push_back(lbl);
+    return lbls.size() - 1;
+  }
+
+  void write_labels(const vector<std::string> &lbls) {
+    static const char pad[4] = {0, 0, 0, 0};
+    for (unsigned int i = 0; i < lbls.size(); i++) {
+      uint32_t len = lbls[i].size();
+      write(&len, 1);
+      _out.write(lbls[i].data(), len);
+      _out.write(pad, ((len + 3) & ~3u) - len);
+    }
+  }
+
+  ofstream _out;
+  vector<uint64_t> _offsets;
+  map<std::string, uint32_t> _vlbl_ids;
+  map<std::string, uint32_t> _elbl_ids;
+  vector<std::string> _vlabels;
+  vector<std::string> _elabels;
+
+}; // end class graph_bin_writer
+
+#endif
@@ -23,6 +23,9 @@
 using namespace std;
 
 #include "generic_classes.h"
+#include "graph_code_key.h"
+#include <atomic>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <string>
@@ -30,7 +33,7 @@ using namespace std;
 #include <unordered_map>
 #include <vector>
 
-time_tracker tt_iostream;
+thread_local time_tracker tt_iostream;
 
 template <typename V_T, typename E_T> struct five_tuple;
 
@@ -388,13 +391,18 @@ public:
     // p[t_str.length()] = 0;
     // HASHNS::hash_map<const char*, int, HASHNS::hash<const char*>,
     // eqstr>::iterator itr = level_one_hash.find(p);
-    std::unordered_map<string, int>::iterator itr = level_one_hash.find(t_str);
-    if (itr != level_one_hash.end()) {
-      _can_code = itr->second;
-      // delete [] p;
-    } else {
-      // level_one_hash.insert(make_pair(p, _can_code));
-      level_one_hash.insert(make_pair(t_str, _can_code));
+    {
+      // several walker threads may build single-edge patterns at once
+      std::lock_guard<std::mutex> guard(level_one_lock);
+      std::unordered_map<string, int>::iterator itr =
+          level_one_hash.find(t_str);
+      if (itr != level_one_hash.end()) {
+        _can_code = itr->second;
+        // delete [] p;
+      } else {
+        // level_one_hash.insert(make_pair(p, _can_code));
+        level_one_hash.insert(make_pair(t_str, _can_code));
+      }
     }
 
     tt_iostream.stop();
@@ -422,6 +430,8 @@ public:
 
   void update_code() { _can_code = id_generator++; }
 
+  void set_code(const STORAGE_TYPE &c) { _can_code = c; }
+
   STORAGE_TYPE getCode() const { return _can_code; }
 
   // canonical dfs code test, test for every edges lexicographically
@@ -474,15 +484,17 @@ public:
   /**
    * Converts the canonical code to a string.
    */
-  std::string to_string() const {
+  std::string to_string() const { return to_string(_dfs_code); }
+
+  static std::string to_string(const TUPLES &dfs_code) {
 
     ostringstream t_ss;
 
-    for (unsigned int i = 0; i < _dfs_code.size(); i++) {
+    for (unsigned int i = 0; i < dfs_code.size(); i++) {
       if (i == 0)
-        t_ss << _dfs_code[i];
+        t_ss << dfs_code[i];
       else
-        t_ss << ":" << _dfs_code[i];
+        t_ss << ":" << dfs_code[i];
     }
 
     string t_str = t_ss.str();
@@ -490,6 +502,46 @@ public:
     return t_str;
   }
 
+  /**
+   * Packs the code into a code_key, for hashed lookups without formatting
+   * the code as a string.
+   */
+  code_key key() const {
+    code_key k;
+    k.bytes.reserve(_dfs_code.size() * 5);
+    for (unsigned int i = 0; i < _dfs_code.size(); i++)
+      pack(k.bytes, _dfs_code[i]);
+    k.finish();
+    return k;
+  }
+
+  /** key() of this code followed by the tuple next */
+  code_key key(const FIVE_TUPLE &next) const {
+    code_key k;
+    k.bytes.reserve((_dfs_code.size() + 1) * 5);
+    for (unsigned int i = 0; i < _dfs_code.size(); i++)
+      pack(k.bytes, _dfs_code[i]);
+    pack(k.bytes, next);
+    k.finish();
+    return k;
+  }
+
+  /** Returns the string to_string() gives for the code packed in k */
+  static std::string to_string(const code_key &k) {
+    TUPLES dfs_code;
+    const char *p = k.bytes.data(), *e = p + k.bytes.size();
+    while (p < e) {
+      FIVE_TUPLE t;
+      t._i = get_int(p);
+      t._j = get_int(p);
+      unpack_label(p, t._li);
+      unpack_label(p, t._lij);
+      unpack_label(p, t._lj);
+      dfs_code.push_back(t);
+    }
+    return to_string(dfs_code);
+  }
+
   static double graph_distance(const CAN_CODE &c1, const CAN_CODE &c2) {
     multiset<EDGE_T, ltedge> set1, set2;
     vector<EDGE_T> result;
@@ -534,6 +586,14 @@ public:
                                 const canonical_code<GRAPH_PROP, V_T, E_T> &);
 
 private:
+  static void pack(std::string &out, const FIVE_TUPLE &t) {
+    put_varint(out, t._i);
+    put_varint(out, t._j);
+    pack_label(out, t._li);
+    pack_label(out, t._lij);
+    pack_label(out, t._lj);
+  }
+
   STORAGE_TYPE _can_code;
   TUPLES _dfs_code;
   // the following two maps are very important. They maps vertex_id_in_code
@@ -545,8 +605,9 @@ private:
   VID_HMAP _cid_to_gid; // code -> graph cand
   VID_HMAP _gid_to_cid; // cand graph -> code
   RMP_T _rmp;
-  static int id_generator;
+  static std::atomic<int> id_generator;
   static std::unordered_map<string, int> level_one_hash;
+  static std::mutex level_one_lock;
 
 }; // end class canonical_code for graph
 
@@ -561,11 +622,14 @@ ostream &operator<<(ostream &ostr,
 }
 
 template <class PP, typename v, typename e>
-int canonical_code<GRAPH_PROP, v, e>::id_generator = 1;
+std::atomic<int> canonical_code<GRAPH_PROP, v, e>::id_generator(1);
 
 template <class PP, typename v, typename e>
 std::unordered_map<string, int>
     canonical_code<GRAPH_PROP, v, e>::level_one_hash;
+
+template <class PP, typename v, typename e>
+std::mutex canonical_code<GRAPH_PROP, v, e>::level_one_lock;
 /*
 template<class PP, typename v, typename e, template <typename> class ALLOC >
 HASHNS::hash_map<const char*, int, HASHNS::hash<const char*>, eqstr>
@@ -0,0 +1,142 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file graph_code_key.h - packed binary form of a graph canonical code,
+ * used as a hash key */
+#ifndef _GRAPH_CODE_KEY_H
+#define _GRAPH_CODE_KEY_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "hash_utils.hpp"
+#include "label_dict.h"
+
+/**
+ * \brief A canonical code packed into bytes, with a 128-bit fingerprint.
+ *
+ * Each five-tuple is written as varints: the two dfs ids, then the labels
+ * (dictionary ids for dict_label, see pack_label()). The fingerprint is
+ * computed once by finish(); equal keys are told apart by it and confirmed
+ * on the bytes, so no two different codes are ever merged.
+ */
+struct code_key {
+  std::string bytes; /**< packed five-tuples */
+  uint64_t fp[2];    /**< fingerprint of bytes */
+
+  code_key() { fp[0] = fp[1] = 0; }
+
+  /** Computes the fingerprint, once all tuples are packed */
+  void finish() {
+    fp[0] = hash_bytes(bytes.data(), bytes.size());
+
+    // second, independent lane: 8 bytes at a time, splitmix64 mixing
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ bytes.size();
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+      uint64_t w;
+      memcpy(&w, bytes.data() + i, 8);
+      h = mix(h ^ w);
+    }
+    uint64_t w = 0;
+    memcpy(&w, bytes.data() + i, bytes.size() - i);
+    fp[1] = mix(h ^ w);
+  }
+
+  bool operator==(const code_key &rhs) const {
+    return fp[0] == rhs.fp[0] && fp[1] == rhs.fp[1] && bytes == rhs.bytes;
+  }
+  bool operator!=(const code_key &rhs) const { return !(*this == rhs); }
+
+  /** An arbitrary, fixed order (by fingerprint) */
+  bool operator<(const code_key &rhs) const {
+    if (fp[0] != rhs.fp[0])
+      return fp[0] < rhs.fp[0];
+    if (fp[1] != rhs.fp[1])
+      return fp[1] < rhs.fp[1];
+    return bytes < rhs.bytes;
+  }
+
+  static uint64_t mix(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+}; // end struct code_key
+
+template <> struct myhash<code_key> {
+  std::size_t operator()(const code_key &k) const noexcept { return k.fp[0]; }
+};
+
+inline void put_varint(std::string &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back((char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((char)v);
+}
+
+inline uint64_t get_varint(const char *&p) {
+  uint64_t v = 0;
+  for (unsigned int shift = 0;; shift += 7) {
+    unsigned char b = *p++;
+    v |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return v;
+  }
+}
+
+// signed values are zigzag encoded, so that small negatives stay short
+inline void put_varint(std::string &out, const int &i) {
+  put_varint(out, (uint64_t)(((uint32_t)i << 1) ^ (uint32_t)(i >> 31)));
+}
+
+inline int get_int(const char *&p) {
+  uint32_t z = (uint32_t)get_varint(p);
+  return (int)((z >> 1) ^ -(z & 1));
+}
+
+/** Packs a label into out; one overload per label type */
+inline void pack_label(std::string &out, const dict_label &l) {
+  put_varint(out, (uint64_t)l.id());
+}
+
+inline void pack_label(std::string &out, const int &l) { put_varint(out, l); }
+
+inline void pack_label(std::string &out, const std::string &l) {
+  put_varint(out, (uint64_t)l.size());
+  out.append(l);
+}
+
+/** Reads back a label written by pack_label() */
+inline void unpack_label(const char *&p, dict_label &l) {
+  l = dict_label((uint32_t)get_varint(p));
+}
+
+inline void unpack_label(const char *&p, int &l) { l = get_int(p); }
+
+inline void unpack_label(const char *&p, std::string &l) {
+  size_t n = get_varint(p);
+  l.assign(p, n);
+  p += n;
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file graph_extensions.h - enumeration of the frequent one-edge extensions
+ * of a pattern from its embeddings */
+#ifndef _GRAPH_EXTENSIONS_H
+#define _GRAPH_EXTENSIONS_H
+
+#include "trans_graphs.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \brief One-edge extension of a pattern: an edge labelled e_lbl from
+ * pattern vertex src, either to pattern vertex dest (a back edge, src <
+ * dest) or, when dest is -1, to a new vertex labelled dest_lbl.
+ */
+template <typename V_T, typename E_T> struct graph_extension {
+  int src;
+  int dest;
+  V_T dest_lbl;
+  E_T e_lbl;
+  int sup; // number of transactions with an embedding of the extension
+
+  bool is_fwd() const { return dest < 0; }
+
+  bool operator<(const graph_extension &o) const {
+    if (src != o.src)
+      return src < o.src;
+    if (dest != o.dest)
+      return dest < o.dest;
+    if (dest_lbl != o.dest_lbl)
+      return dest_lbl < o.dest_lbl;
+    return e_lbl < o.e_lbl;
+  }
+};
+
+/**
+ * Collects in exts every extension of pat that has at least minsup support,
+ * with its support, in a single scan of the embeddings of pat's VAT v
+ * against the transaction graphs.
+ *
+ * For every vertex of an embedding, each edge of the transaction that the
+ * embedding does not use yet gives an extension: a back edge when it leads to
+ * another vertex of the embedding whose pattern vertex is not yet adjacent,
+ * a forward edge otherwise. These are the embeddings a VAT intersection with
+ * the edge's level-one VAT would produce, so an extension's support is that
+ * of the candidate count_support would build for it. pat is maximal when
+ * exts comes back empty.
+ */
+template <class PATTERN, class VAT, typename V_T, typename E_T>
+void frequent_extensions(const PATTERN *pat, const VAT *v,
+                         const trans_graphs<V_T, E_T> &db, const int &minsup,
+                         vector<graph_extension<V_T, E_T>> &exts) {
+  typedef graph_extension<V_T, E_T> EXT;
+  // support of each extension, and the last tid counted for it
+  typedef map<EXT, pair<int, int>> COUNTS;
+  COUNTS counts;
+
+  const unsigned int nv = pat->size();
+  E_T e;
+  v->for_each_embedding([&](const int &tid, const int *vids) {
+    for (unsigned int i = 0; i < nv; i++) {
+      int tv = db.vertex(tid, vids[i]);
+      if (tv < 0)
+        continue;
+      for (unsigned int k = db.adj_begin(tv); k < db.adj_end(tv); k++) {
+        int nb = db.neighbor(k);
+        const int *at = find(vids, vids + nv, db.vid(nb));
+        EXT x;
+        x.src = i;
+        if (at != vids + nv) {
+          unsigned int j = at - vids;
+          // each back edge is taken from its smaller end only
+          if (j <= i || pat->get_out_edge(i, j, e))
+            continue;
+          x.dest = j;
+          x.dest_lbl = pat->label(j);
+        } else {
+          x.dest = -1;
+          x.dest_lbl = db.label(nb);
+        }
+        x.e_lbl = db.edge_label(k);
+
+        pair<int, int> &c =
+            counts.insert(make_pair(x, make_pair(0, -1))).first->second;
+        if (c.second != tid) {
+          c.first++;
+          c.second = tid;
+        }
+      }
+    }
+  });
+
+  exts.clear();
+  for (typename COUNTS::const_iterator it = counts.begin(); it != counts.end();
+       it++)
+    if (it->second.first >= minsup) {
+      exts.push_back(it->first);
+      exts.back().sup = it->second.first;
+    }
+} // end frequent_extensions()
+
+#endif
@@ -24,6 +24,7 @@
 #ifndef _GRAPH_ISO_CHECK_H
 #define _GRAPH_ISO_CHECK_H
 
+#include "metrics.h"
 #include "time_tracker.h"
 #include "typedefs.h"
 #include <algorithm>
@@ -48,128 +49,291 @@ template <class prop, class next_property> class proplist;
 
 template <typename V_T, typename E_T> struct lt_five_tuple;
 
-template <class PP, class MP, class PAT_ST,
-          template <class, typename, typename> class CC>
-CC<GRAPH_PROP, typename GRAPH_PATTERN::VERTEX_T, typename GRAPH_PATTERN::EDGE_T>
-check_isomorphism(GRAPH_PATTERN *const &cand_pat) {
+template <typename PATTERN>
+void iso_startup(const PATTERN *cand_pat, typename PATTERN::VERTEX_T &src_v,
+                 typename PATTERN::VERTEX_T &dest_v,
+                 typename PATTERN::EDGE_T &e, vector<pair<int, int>> &ids);
 
-  // cout << "Inside check_isomorphism..." << endl;
+/**
+ * \brief Minimum DFS code search, the one minimal() and extend() carry out,
+ * on flat state.
+ *
+ * The pattern is copied once into arrays: vertex labels and the out-edges of
+ * each vertex, one slot per (vertex, edge) pair. Every candidate code keeps
+ * its code-id/pattern-id maps as vectors and its covered edges as one flag
+ * per slot, so extending a candidate does not copy sets or maps. The search
+ * is incremental over its rounds: when a round starts all surviving
+ * candidates are equal on their common prefix, so candidates are compared
+ * only on the tuples appended since. The buffers are kept between searches.
+ */
+template <typename PATTERN> class min_dfs_search {
+public:
+  typedef typename PATTERN::CAN_CODE CAN_CODE;
+  typedef typename CAN_CODE::FIVE_TUPLE TUP;
+  typedef typename PATTERN::VERTEX_T V_T;
+  typedef typename PATTERN::EDGE_T E_T;
 
-  // How it works: Start with a set of minimal single edge graphs.
-  // Each of these minimal single edge has potential to lead to
-  // *the* minimal code. Extend each candidate minimal graph. In the
-  // process new candidate minimal graphs can be added. After
-  // extending each candidate with one edge, check if the graph is still
-  // minimal. If not remove it from the set of candidates.
+  min_dfs_search() : _num(0) {}
 
-  typedef CC<GRAPH_PROP, typename GRAPH_PATTERN::VERTEX_T,
-             typename GRAPH_PATTERN::EDGE_T>
-      CAN_CODE;
-
-  typename GRAPH_PATTERN::EDGE_T e; // least label of edge
-  typename GRAPH_PATTERN::VERTEX_T src_v,
-      dest_v;                 // least labelled vertices of an edge
-  vector<pair<int, int>> ids; // ids with least labelled edges
-
-  // default startup values
-  src_v =
-      cand_pat->label(0); // src_v has the label of the least vertex in dfs walk
-  dest_v = cand_pat->label(
-      1); // dest_v has the label of the second least vertex in dfs walk
-
-  // some sanity checking,
-  // any candidate pattern, has vertex id, staring from 0, 1 and so on
-  // so this must return an edge, if not, something is wrong ....
-  // Hasan: why not returning an error here, instead of false
-  if (!cand_pat->get_out_edge(0, 1,
-                              e)) { // e is populated with the out-edge label
-
-    cout << "check_iso(graph): get_out_edge failed in startup" << endl;
-    exit(0);
-    // return curr_min_code;
+  /** Returns the minimum DFS code of pat */
+  CAN_CODE run(const PATTERN *pat) {
+    load(pat);
+
+    // the candidate codes start with the least edges
+    V_T src_v = pat->label(0), dest_v = pat->label(1);
+    E_T e;
+    if (!pat->get_out_edge(0, 1, e)) {
+      cout << "check_iso(graph): get_out_edge failed in startup" << endl;
+      exit(0);
+    }
+    vector<pair<int, int>> ids;
+    iso_startup(pat, src_v, dest_v, e, ids);
+
+    _num = 0;
+    for (unsigned int i = 0; i < ids.size(); i++) {
+      cand_code &c = new_cand();
+      int a = ids[i].first, b = ids[i].second;
+      c.code.push_back(TUP(0, 1, _lbl[a], e, _lbl[b]));
+      set_ids(c, 0, a);
+      set_ids(c, 1, b);
+      cover(c, slot(a, b, e));
+    }
+
+    bool go_ahead = true;
+    while (go_ahead) {
+      unsigned int orig_sz = _num;
+      for (unsigned int i = 0; i < orig_sz; i++)
+        _cands[i].stable = _cands[i].code.size();
+
+      bool ret = false;
+      for (unsigned int i = 0; i < orig_sz; i++)
+        ret = (extend(i) | ret);
+      go_ahead = ret;
+
+      // keep the minimal candidates only
+      for (unsigned int i = 0; i + 1 < _num; i++) {
+        for (unsigned int j = i + 1; j < _num;) {
+          if (less(_cands[i], _cands[j])) {
+            std::swap(_cands[j], _cands[_num - 1]);
+            _num--;
+          } else if (less(_cands[j], _cands[i])) {
+            std::swap(_cands[i], _cands[_num - 1]);
+            _num--;
+            j = i + 1;
+          } else {
+            j++;
+          }
+        }
+      }
+    }
+
+    const cand_code &c = _cands[0];
+    CAN_CODE cc(c.code[0], c.gid[0], c.gid[1]);
+    for (unsigned int i = 1; i < c.code.size(); i++) {
+      const TUP &t = c.code[i];
+      if (t._i < t._j)
+        cc.append(t, c.gid[t._i], c.gid[t._j]);
+      else
+        cc.append(t);
+    }
+    return cc;
   }
 
-  // cand_pat, src_v, dest_v and e are input parameters; ids is output
-  // parameters. ids.push_back(make_pair(0, 1));
-  iso_startup(cand_pat, src_v, dest_v, e, ids);
+private:
+  struct cand_code {
+    vector<TUP> code;
+    vector<int> gid;      // code id -> pattern id, -1 if none
+    vector<int> cid;      // pattern id -> code id, -1 if not in the code
+    vector<char> covered; // edges of the code, by slot
+    unsigned int stable;  // length of the code when the round started
+  };
+
+  /** A candidate edge from the vertex being extended */
+  struct cand_edge {
+    TUP t;
+    unsigned int slot;
+    int g_dest;
+  };
+
+  struct lt_cand_edge {
+    bool operator()(const cand_edge &e1, const cand_edge &e2) const {
+      return lt_five_tuple<V_T, E_T>()(e1.t, e2.t);
+    }
+  };
+
+  void load(const PATTERN *pat) {
+    unsigned int n = pat->size();
+    _lbl.resize(n);
+    _off.assign(n + 1, 0);
+    _nbr.clear();
+    _elbl.clear();
+    typename PATTERN::CONST_IT it;
+    for (it = pat->begin(); it != pat->end(); it++)
+      _lbl[it->id] = it->v;
+    for (unsigned int v = 0; v < n; v++) {
+      _off[v] = _nbr.size();
+      typename PATTERN::CONST_EIT_PAIR eit_p = pat->out_edges(v);
+      for (; eit_p.first != eit_p.second; eit_p.first++) {
+        _nbr.push_back(eit_p.first->first);
+        _elbl.push_back(eit_p.first->second);
+      }
+    }
+    _off[n] = _nbr.size();
 
-#ifdef PRINT
-  cout << "Size of ids = " << ids.size() << endl;
-  cout << "Members of ids : " << endl;
-  for (unsigned int k = 0; k < ids.size(); k++)
-    cout << "(" << ids[k].first << ", " << ids[k].second << ")" << endl;
-#endif
+    // the slot of the same edge seen from its other end
+    _rev.resize(_nbr.size());
+    for (unsigned int v = 0; v < n; v++)
+      for (unsigned int s = _off[v]; s < _off[v + 1]; s++)
+        _rev[s] = slot(_nbr[s], v, _elbl[s]);
+  }
 
-  // Each member of this vector corresponds to a minimal canonical code.
-  // At the end of the minimal() method, this vector should have a single
-  // element, which is *the* canonical code.
-  vector<CAN_CODE> new_codes;
-
-  // This vector has one-to-one correspondence with the new_codes
-  // vector. Each element in this vector contains the set of edges
-  // that have already been added to the new_code, so that when
-  // we try to extend this new_code we know which edges we should
-  // not try. Each five_tuple in the set is represented in terms
-  // of the pattern ids.
-  vector<set<typename CAN_CODE::FIVE_TUPLE>> covered_edges;
-
-  // Create separate codes for each pair in ids.
-  // Each such pair shall have to be tested for isomorphism.
-  for (unsigned int i = 0; i < ids.size(); i++) {
-
-    // Add a minimal edge to new_codes.
-    typename CAN_CODE::FIVE_TUPLE cc_tuple(0, 1, cand_pat->label(ids[i].first),
-                                           e, cand_pat->label(ids[i].second));
-    CAN_CODE new_cc(cc_tuple, ids[i].first, ids[i].second);
-    new_codes.push_back(new_cc);
-
-    // Correspondingly update the covered_edges vector.
-    typename CAN_CODE::FIVE_TUPLE g_tuple(
-        ids[i].first, ids[i].second, cc_tuple._li, cc_tuple._lij, cc_tuple._lj);
-    set<typename CAN_CODE::FIVE_TUPLE> s;
-    s.insert(g_tuple);
-    covered_edges.push_back(s);
-
-    /*********
-        // If the edge labels are the same then need to extend it both ways.
-        if(cand_pat->label(ids[i].first) == cand_pat->label(ids[i].second)) {
-
-          typename CAN_CODE::FIVE_TUPLE rev_cc_tuple(0, 1,
-    cand_pat->label(ids[i].second), e, cand_pat->label(ids[i].first)); CAN_CODE
-    another_new_cc(rev_cc_tuple, ids[i].second, ids[i].first);
-          new_codes.push_back(another_new_cc);
-
-          // Correspondingly update the covered_edges vector.
-          typename CAN_CODE::FIVE_TUPLE rev_g_tuple(ids[i].second, ids[i].first,
-                                                    rev_cc_tuple._lj,
-                                                    rev_cc_tuple._lij,
-    rev_cc_tuple._li); set<typename CAN_CODE::FIVE_TUPLE> s2;
-          s2.insert(rev_g_tuple);
-          covered_edges.push_back(s2);
-        }
-    *********/
+  unsigned int slot(const int &src, const int &dest, const E_T &e) const {
+    for (unsigned int s = _off[src]; s < _off[src + 1]; s++)
+      if (_nbr[s] == dest && _elbl[s] == e)
+        return s;
+    return _off[src]; // not reached for the edges of a pattern
   }
 
-#ifdef PRINT
-  cout << "Before minimal. size of new_codes = " << new_codes.size() << endl;
-  cout << "new_codes[0] = " << new_codes[0] << endl;
-#endif
+  cand_code &new_cand() {
+    if (_num == _cands.size())
+      _cands.push_back(cand_code());
+    cand_code &c = _cands[_num++];
+    c.code.clear();
+    c.gid.assign(_lbl.size(), -1);
+    c.cid.assign(_lbl.size(), -1);
+    c.covered.assign(_nbr.size(), 0);
+    c.stable = 0;
+    return c;
+  }
 
-  // Each of the above new codes, which are equivalent are passed to the
-  // minimal routine. Minimal routine will add more edges
-  // and remove some of the candidate minimal codes until it comes up
-  // with a single min canonical code.
-  minimal(new_codes, covered_edges, cand_pat);
+  void set_ids(cand_code &c, const int &ci, const int &gi) {
+    if (ci >= (int)c.gid.size())
+      c.gid.resize(ci + 1, -1);
+    if (c.gid[ci] == -1)
+      c.gid[ci] = gi;
+    if (c.cid[gi] == -1)
+      c.cid[gi] = ci;
+  }
 
-#ifdef PRINT
-  if (new_codes.size() != 1)
-    cout << "# OF MINIMAL CODES != 1 => " << new_codes.size() << endl;
-#endif
+  void cover(cand_code &c, const unsigned int &s) {
+    c.covered[s] = 1;
+    c.covered[_rev[s]] = 1;
+  }
+
+  /** Same as comparing the codes with CAN_CODE::operator<, given that they
+   * are equal before their stable lengths */
+  static bool less(const cand_code &a, const cand_code &b) {
+    unsigned int p = std::min(a.stable, b.stable);
+    for (; p < a.code.size() && p < b.code.size(); p++)
+      if (a.code[p] < b.code[p])
+        return true;
+    return false;
+  }
+
+  /**
+   * Extends candidate idx as extend() does: with all back edges from the
+   * last vertex that has uncovered edges, then with its least forward edge;
+   * a copy of the candidate is made for each other forward edge equal to it.
+   */
+  bool extend(const unsigned int &idx) {
+    cand_code *c = &_cands[idx];
+    const TUP &last = c->code.back();
+    int last_vid = (last._i < last._j) ? last._j : last._i;
+    int g_src = c->gid[last_vid];
+
+    _edges.clear();
+    while (true) {
+      int curr_fwd_cid = -1;
+      for (unsigned int s = _off[g_src]; s < _off[g_src + 1]; s++) {
+        int g_dest = _nbr[s];
+        int c_dest = c->cid[g_dest];
+        if (c_dest == -1)
+          c_dest = curr_fwd_cid--;
+        if (c->covered[s])
+          continue;
+        cand_edge ce;
+        ce.t = TUP(last_vid, c_dest, _lbl[g_src], _elbl[s], _lbl[g_dest]);
+        ce.slot = s;
+        ce.g_dest = g_dest;
+        _edges.push_back(ce);
+      }
+      if (!_edges.empty())
+        break;
+
+      // no extensions from this vertex
+      last_vid--;
+      if (last_vid == -1)
+        return false;
+      g_src = c->gid[last_vid];
+    }
+
+    sort(_edges.begin(), _edges.end(), lt_cand_edge());
+
+    // insert all the back edges
+    unsigned int z = 0;
+    for (; z < _edges.size(); z++) {
+      const TUP &t = _edges[z].t;
+      if (!(t._j < t._i && t._j >= 0))
+        break;
+      c->code.push_back(t);
+      cover(*c, _edges[z].slot);
+    }
+    if (z == _edges.size())
+      return true;
+
+    // each forward edge equal to the least one goes to its own candidate
+    unsigned int first_fwd = z++;
+    for (; z < _edges.size() && _edges[z].t == _edges[first_fwd].t; z++) {
+      cand_code &copy = new_cand();
+      c = &_cands[idx]; // new_cand() may have moved it
+      copy = *c;
+      add_fwd(copy, _edges[z]);
+    }
+    add_fwd(*c, _edges[first_fwd]);
+    return true;
+  }
+
+  void add_fwd(cand_code &c, const cand_edge &ce) {
+    const TUP &last = c.code.back();
+    int c_last_vid = (last._i < last._j) ? last._j : last._i;
+    int c_new_dest_id = c_last_vid + 1;
+    const TUP &t = ce.t;
+    int g_new_src_id = c.gid[t._i];
+    c.code.push_back(TUP(t._i, c_new_dest_id, t._li, t._lij, t._lj));
+    set_ids(c, t._i, g_new_src_id);
+    set_ids(c, c_new_dest_id, ce.g_dest);
+    cover(c, ce.slot);
+  }
+
+  // the pattern
+  vector<V_T> _lbl;          // label of each vertex
+  vector<unsigned int> _off; // out-edges of vertex v are slots [off[v], off[v+1])
+  vector<int> _nbr;          // other end of each slot
+  vector<E_T> _elbl;         // edge label of each slot
+  vector<unsigned int> _rev; // slot of the same edge from the other end
+
+  vector<cand_code> _cands; // candidates [0, _num) are live
+  unsigned int _num;
+  vector<cand_edge> _edges;
+
+}; // end class min_dfs_search
+
+template <class PP, class MP, class PAT_ST,
+          template <class, typename, typename> class CC>
+CC<GRAPH_PROP, typename GRAPH_PATTERN::VERTEX_T, typename GRAPH_PATTERN::EDGE_T>
+check_isomorphism(GRAPH_PATTERN *const &cand_pat) {
 
-  // cout << "LEAVING check_isomorphism..." << endl;
-  // cout << "MIN CODE = " << endl << new_codes[0] << endl;
+  // How it works: Start with a set of minimal single edge graphs.
+  // Each of these minimal single edge has potential to lead to
+  // *the* minimal code. Extend each candidate minimal graph. In the
+  // process new candidate minimal graphs can be added. After
+  // extending each candidate with one edge, check if the graph is still
+  // minimal. If not remove it from the set of candidates.
+  // See min_dfs_search, the walker threads have one each.
 
-  return new_codes[0];
+  static thread_local min_dfs_search<GRAPH_PATTERN> search;
+  metric_timer t(metrics::ISO_CHECK);
+  return search.run(cand_pat);
 }
 
 // find minimal pair, acc to DFS ordering
@@ -0,0 +1,600 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _GRAPH_LINKED_VAT_H
+#define _GRAPH_LINKED_VAT_H
+
+#include "bump_arena.h"
+#include "generic_classes.h"
+#include "graph_vat.h"
+#include "helper_funs.h"
+#include "incidence_index.h"
+#include "tid_bitset.h"
+#include "typedefs.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+template <typename PP, typename MP>
+class vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage>;
+
+template <typename PP, typename MP>
+ostream &operator<<(ostream &ostr,
+                    const vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage> *v);
+
+/**
+ * \brief Graph VAT class whose embeddings link to the embeddings of the
+ * parent pattern's VAT, selected by passing linked_storage as the ST
+ * argument.
+ *
+ * As in the projected databases of gSpan, an embedding of a candidate only
+ * holds what it adds to the parent embedding it extends: the index of that
+ * embedding, the new vertex of a forward edge and the new edge. An embedding
+ * takes the same space whatever the size of the pattern, and a candidate
+ * shares all of its prefix with the parent. The vertices and edges of an
+ * embedding are rebuilt by following the links down to the level-one VAT
+ * (get_row()).
+ *
+ * A VAT keeps its parent alive through a shared_ptr, taken from the handle
+ * that owns the parent when intersecting; VATs of this layout must thus be
+ * owned by shared_ptrs, as with concurrent_memory_storage (see
+ * shared_vats_only, which keeps memory_storage from intersecting them).
+ * Deleting a VAT from the storage manager then only frees it once no
+ * candidate built from it is left. byte_size() charges a VAT with the
+ * parents it keeps alive.
+ *
+ * Duplicate embeddings are told by the hash of their edge set, a sum of
+ * per-edge hashes carried along the links, and equal hashes are checked on
+ * the rebuilt edge sets. Embeddings come in the same order, and the same
+ * ones are dropped, as in the other layouts. Level-one VATs index their rows
+ * by end vertex, as in the arena layout.
+ */
+template <typename PP, typename MP>
+class vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage>
+    : public std::enable_shared_from_this<
+          vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage>> {
+public:
+  typedef vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage> VAT;
+
+  /** One embedding, as added to an embedding of the parent VAT */
+  struct link {
+    unsigned int up; // parent embedding, in the parent block of the same tid
+    int v;           // vertex added by a forward edge, else -1
+    int a, b;        // edge added; the two vertices at level one
+    uint64_t hash;   // of the edge set
+  };
+
+  /** Embeddings of a pattern in one transaction */
+  struct tid_block {
+    int tid;
+    unsigned int up;    // block of the same tid in the parent VAT
+    unsigned int count; // number of rows
+    unsigned int cap;   // rows reserved in the arena
+    link *rows;
+  };
+
+  typedef vector<tid_block> BLOCKS;
+  typedef typename BLOCKS::const_iterator CONST_IT;
+
+  vat() : _nv(0), _ne(0) {}
+
+  void *operator new(size_t size) {
+    metrics::add(metrics::VAT_ALLOC);
+    return alloc_bytes<ALLOC>(size);
+  }
+
+  void operator delete(void *p, size_t size) { free_bytes<ALLOC>(p, size); }
+
+  CONST_IT begin() const { return _blocks.begin(); }
+  CONST_IT end() const { return _blocks.end(); }
+
+  friend ostream &operator<< <>(ostream &, const VAT *);
+
+  int size() const { return _blocks.size(); }
+
+  bool empty() const { return _blocks.empty(); }
+
+  /** Tid of the last transaction in the VAT */
+  int last_tid() const { return _blocks.back().tid; }
+
+  const tid_bitset &tids() const { return _tids; }
+
+  /** Number of vertices and edges of each embedding */
+  unsigned int num_vertices() const { return _nv; }
+  unsigned int num_edges() const { return _ne; }
+
+  /**
+   * Writes the vertex ids of the idx-th embedding of block b to vs and, if
+   * es is not null, its edges, in the order they were added, to es.
+   */
+  void get_row(const tid_block &b, const unsigned int &idx, int *vs,
+               int *es) const {
+    const link &l = b.rows[idx];
+    if (!_parent) {
+      vs[0] = l.a;
+      vs[1] = l.b;
+    } else {
+      _parent->get_row(_parent->_blocks[b.up], l.up, vs, es);
+      if (l.v >= 0)
+        vs[_parent->_nv] = l.v;
+    }
+    if (es) {
+      es[2 * (_ne - 1)] = l.a;
+      es[2 * (_ne - 1) + 1] = l.b;
+    }
+  }
+
+  /**
+   * Adds an embedding of a single-edge pattern, for the edge (vid1, vid2) of
+   * transaction tid. Only used from graph_tokenizer.h, while building the
+   * level-one VATs.
+   */
+  void insert_edge(const int &tid, const int &vid1, const int &vid2) {
+    if (!_nv) {
+      _nv = 2;
+      _ne = 1;
+    }
+    link *l = append_row(tid, 0);
+    l->up = 0;
+    l->v = -1;
+    l->a = vid1;
+    l->b = vid2;
+    l->hash = edge_hash(vid1, vid2);
+    _inc.add(_blocks.size() - 1, vid1, vid2, _blocks.back().count - 1);
+  }
+
+  /**
+   * Completes the VAT once all its embeddings are inserted; done by db_reader
+   * for every level-one VAT it keeps, before any is intersected.
+   */
+  void finish() { _inc.finish(); }
+
+  /**
+   * Moves the embeddings of other, a level-one VAT, to the end of this VAT;
+   * the tids of other must not be smaller than the last tid here. This VAT
+   * takes over the arena of other.
+   */
+  void append(VAT &other) {
+    if (other._blocks.empty())
+      return;
+    if (!_nv) {
+      _nv = other._nv;
+      _ne = other._ne;
+    }
+
+    typename BLOCKS::iterator it = other._blocks.begin();
+    bool merge = !_blocks.empty() && _blocks.back().tid == it->tid;
+    _inc.append(other._inc, merge, merge ? _blocks.back().count : 0);
+    if (merge) { // same tid
+      for (unsigned int i = 0; i < it->count; i++)
+        *append_row(it->tid, 0) = it->rows[i];
+      it++;
+    }
+    for (typename BLOCKS::iterator b = it; b != other._blocks.end(); b++)
+      _tids.push_back(b->tid);
+    _blocks.insert(_blocks.end(), it, other._blocks.end());
+    _arena.adopt(other._arena);
+    other._blocks.clear();
+    other._tids.clear();
+  }
+
+  /**
+   * Print the tids for the vat.
+   */
+  void print_tids() {
+    for (CONST_IT it = begin(); it != end(); it++) {
+      if (it == begin())
+        cout << it->tid;
+      else
+        cout << ", " << it->tid;
+    }
+    cout << endl;
+  }
+
+  /**
+   * get the tids for the vat.
+   */
+  void get_tids(vector<unsigned int> &tids) {
+    for (CONST_IT it = begin(); it != end(); it++)
+      tids.push_back(it->tid);
+  }
+
+  /**
+   * Calls f(tid, vids) for every embedding, in tid order; vids points to the
+   * ids of the vertices of the embedding, one per pattern vertex.
+   */
+  template <typename FUNC> void for_each_embedding(FUNC f) const {
+    vector<int> vs(_nv);
+    for (CONST_IT it = begin(); it != end(); it++)
+      for (unsigned int i = 0; i < it->count; i++) {
+        get_row(*it, i, vs.data(), 0);
+        f(it->tid, vs.data());
+      }
+  }
+
+  /**
+   * Jaccard distance between the tid lists of two VATs.
+   */
+  static double get_tid_distance(const VAT *v1, const VAT *v2) {
+    unsigned int intersection_size =
+        tid_bitset::count_common(v1->_tids, v2->_tids);
+    unsigned int union_size = v1->size() + v2->size() - intersection_size;
+    return 1.0 - (double)intersection_size / union_size;
+  }
+
+  /** Main vat intersection function; It also populates support argument passed
+   */
+  // NOTE: only one candidate is generated in a FkxF1 join of graphs,
+  // hence only the first value in cand_pats should be inspected
+  template <typename PATTERN, typename PAT_SUP>
+  static VAT **intersection(const VAT *v1, const VAT *v2, PAT_SUP **cand_sups,
+                            PATTERN **cand_pats, bool isfwd,
+                            const pair<int, int> &vids, const int &minsup) {
+    if ((int)tid_bitset::count_common(v1->_tids, v2->_tids) < minsup)
+      return NULL;
+
+    VAT **cand_vats = new VAT *;
+    int dest = isfwd ? (int)v1->_nv : vids.second;
+    char live = 1;
+    join(v1, v2, 1, &live, vids.first, &dest, cand_vats);
+    cand_sups[0]->set_sup(make_pair(cand_vats[0]->size(), 0));
+    return cand_vats;
+  } // end intersect()
+
+  /**
+   * Batched intersection, as in the arena layout: candidate c adds the edge
+   * of v2 from pattern vertex src to dests[c], a new vertex when dests[c] is
+   * the number of vertices of v1, and null candidates are skipped. Returns
+   * the num VATs, or NULL when all are null or the tids leave none of them
+   * frequent.
+   */
+  template <typename PATTERN, typename PAT_SUP>
+  static VAT **intersection(const VAT *v1, const VAT *v2, PAT_SUP **cand_sups,
+                            PATTERN **cand_pats, const int &num,
+                            const int &src, const int *dests,
+                            const int &minsup) {
+    if (std::count(cand_pats, cand_pats + num, (PATTERN *)0) == num ||
+        (int)tid_bitset::count_common(v1->_tids, v2->_tids) < minsup)
+      return NULL;
+
+    VAT **cand_vats = new VAT *[num];
+    vector<char> live(num);
+    for (int c = 0; c < num; c++)
+      live[c] = cand_pats[c] != 0;
+    join(v1, v2, num, live.data(), src, dests, cand_vats);
+    for (int c = 0; c < num; c++)
+      if (cand_pats[c])
+        cand_sups[c]->set_sup(make_pair(cand_vats[c]->size(), 0));
+    return cand_vats;
+  } // end intersect()
+
+  /**
+   * Bytes taken by the rows reserved for the embeddings, the blocks, the tid
+   * bitset and the incidence index, not counting unused arena space, and by
+   * the parent VATs this one keeps alive. Level-one VATs are left out, as
+   * they are kept for the whole run anyway. Parents may be shared by several
+   * VATs, so this is an upper bound on what freeing the VAT gives back.
+   */
+  unsigned long int byte_size() const {
+    unsigned long int sz = own_bytes();
+    for (const VAT *p = _parent.get(); p && p->_parent; p = p->_parent.get())
+      sz += p->own_bytes() + sizeof(VAT);
+    return sz;
+  }
+
+private:
+  /**
+   * Hashes of the edge sets of the embeddings in one block of a candidate,
+   * for dropping duplicate embeddings; an open-addressing table as in
+   * embedding_set, whose reset() also clears only the slots taken.
+   */
+  class dup_table {
+  public:
+    dup_table() : _size(0) {}
+
+    void reset() {
+      _size = 0;
+      if (_slots.size() < MIN_SLOTS)
+        _slots.assign(MIN_SLOTS, slot());
+      else
+        for (size_t k = 0; k < _used.size(); k++)
+          _slots[_used[k]] = slot();
+      _used.clear();
+    }
+
+    /** Adds row idx of block b of v; returns false if an earlier row of b
+     * has the same edge set */
+    bool insert(const VAT *v, const tid_block &b, const unsigned int &idx) {
+      if (2 * (_size + 1) > _slots.size())
+        grow();
+      uint64_t h = b.rows[idx].hash;
+      size_t mask = _slots.size() - 1;
+      size_t pos = h & mask;
+      while (_slots[pos].row) {
+        if (_slots[pos].hash == h && v->same_edges(b, _slots[pos].row - 1, idx))
+          return false;
+        pos = (pos + 1) & mask;
+      }
+      _slots[pos].hash = h;
+      _slots[pos].row = idx + 1;
+      _used.push_back(pos);
+      _size++;
+      return true;
+    }
+
+  private:
+    static const size_t MIN_SLOTS = 64; // power of two
+
+    struct slot {
+      slot() : hash(0), row(0) {}
+      uint64_t hash;
+      unsigned int row; // 1 + row index, 0 if empty
+    };
+
+    void grow() {
+      vector<slot> slots(2 * _slots.size());
+      size_t mask = slots.size() - 1;
+      for (size_t k = 0; k < _used.size(); k++) {
+        size_t i = _used[k];
+        size_t pos = _slots[i].hash & mask;
+        while (slots[pos].row)
+          pos = (pos + 1) & mask;
+        slots[pos] = _slots[i];
+        _used[k] = pos;
+      }
+      _slots.swap(slots);
+    }
+
+    unsigned int _size;
+    vector<slot> _slots;
+    vector<size_t> _used; // slots taken since reset()
+  };
+
+  /** Hash of the edge (a, b); edge set hashes are sums of these */
+  static uint64_t edge_hash(const int &a, const int &b) {
+    uint64_t x = ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+    x += 0x9e3779b97f4a7c15ULL; // splitmix64
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  /** True if rows i and j of block b have the same edge set */
+  bool same_edges(const tid_block &b, const unsigned int &i,
+                  const unsigned int &j) const {
+    static thread_local vector<int> vs, es;
+    static thread_local vector<pair<int, int>> ei, ej;
+    vs.resize(_nv);
+    es.resize(2 * _ne);
+    get_row(b, i, vs.data(), es.data());
+    sorted_edges(es.data(), _ne, ei);
+    get_row(b, j, vs.data(), es.data());
+    sorted_edges(es.data(), _ne, ej);
+    return ei == ej;
+  }
+
+  /**
+   * Builds the VATs of the num candidates that add the edge of v2 at vertex
+   * src of v1, candidate c leading to dests[c] (see intersection()); those
+   * with live[c] unset are skipped and get no VAT.
+   */
+  static void join(const VAT *v1, const VAT *v2, const int &num,
+                   const char *live, const int &src, const int *dests,
+                   VAT **cand_vats) {
+    std::shared_ptr<const VAT> parent = v1->weak_from_this().lock();
+    if (!parent) {
+      cerr << "vat<linked_storage>: a VAT must be owned by a shared_ptr to "
+              "be intersected"
+           << endl;
+      exit(1);
+    }
+
+    // candidate of each vertex an edge may lead to, a new vertex last
+    static thread_local vector<int> cand_at;
+    cand_at.assign(v1->_nv + 1, -1);
+    for (int c = 0; c < num; c++) {
+      cand_vats[c] = 0;
+      if (!live[c])
+        continue;
+      VAT *cand_vat = new VAT;
+      cand_vat->_parent = parent;
+      cand_vat->_nv = v1->_nv + (dests[c] == (int)v1->_nv ? 1 : 0);
+      cand_vat->_ne = v1->_ne + 1;
+      cand_vats[c] = cand_vat;
+      cand_at[dests[c]] = c;
+    }
+
+    tid_bitset::for_common(
+        v1->_tids, v2->_tids,
+        [&](unsigned int, unsigned int i1, unsigned int i2) {
+          multi_intersect(v1, i1, v2, i2, src, cand_at, cand_vats);
+        });
+  }
+
+  /**
+   * For a given transaction, extends every embedding of v1 in its block i1
+   * by each single-edge embedding of v2, in its block i2, that starts at the
+   * vertex src, adding the result to the VAT of the candidate for the vertex
+   * the edge leads to.
+   */
+  void static multi_intersect(const VAT *v1, const unsigned int &i1,
+                              const VAT *v2, const unsigned int &i2,
+                              const int &src, const vector<int> &cand_at,
+                              VAT **c_vats) {
+    const tid_block &b1 = v1->_blocks[i1];
+    const tid_block &b2 = v2->_blocks[i2];
+    const unsigned int nv = v1->_nv;
+    const unsigned int ne = v1->_ne;
+
+    // Keeps the edge sets of the embeddings added for this tid, by candidate.
+    static thread_local vector<dup_table> dups;
+    if (dups.size() < nv + 1)
+      dups.resize(nv + 1);
+    for (unsigned int d = 0; d <= nv; d++)
+      if (cand_at[d] >= 0)
+        dups[d].reset();
+
+    static thread_local vector<int> vs, es;
+    vs.resize(nv);
+    es.resize(2 * ne);
+    for (unsigned int i = 0; i < b1.count; i++) {
+      v1->get_row(b1, i, vs.data(), es.data());
+      int mapped_v = vs[src];
+
+      pair<incidence_index::CONST_IT, incidence_index::CONST_IT> at =
+          v2->_inc.find(i2, mapped_v);
+      for (incidence_index::CONST_IT e = at.first; e != at.second; e++) {
+        const link &l2 = b2.rows[e->second];
+        int other_v = l2.a == mapped_v ? l2.b : l2.a;
+
+        unsigned int d = find(vs.begin(), vs.end(), other_v) - vs.begin();
+        if (cand_at[d] < 0)
+          continue;
+        if (d < nv && has_edge(es.data(), ne, mapped_v, other_v))
+          continue;
+
+        VAT *c_vat = c_vats[cand_at[d]];
+        link *c = c_vat->append_row(b2.tid, i1);
+        c->up = i;
+        c->v = d == nv ? other_v : -1;
+        c->a = mapped_v;
+        c->b = other_v;
+        c->hash = b1.rows[i].hash + edge_hash(mapped_v, other_v);
+
+        const tid_block &cb = c_vat->_blocks.back();
+        if (!dups[d].insert(c_vat, cb, cb.count - 1))
+          c_vat->drop_last_row(); // this embedding was already added
+      }
+    }
+  }
+
+  /** byte_size() of this VAT alone */
+  unsigned long int own_bytes() const {
+    unsigned long int sz = _blocks.capacity() * sizeof(tid_block);
+    for (CONST_IT it = begin(); it != end(); it++)
+      sz += (unsigned long int)it->cap * sizeof(link);
+    return sz + _tids.byte_size() + _inc.byte_size();
+  }
+
+  /** Returns a new row at the end of the block of tid, which must be the last
+   * block or a new one; up is the parent block of a new block */
+  link *append_row(const int &tid, const unsigned int &up) {
+    if (_blocks.empty() || _blocks.back().tid != tid) {
+      tid_block b;
+      b.tid = tid;
+      b.up = up;
+      _tids.push_back(tid);
+      b.count = 0;
+      b.cap = 4;
+      b.rows = _arena.allocate(b.cap);
+      _blocks.push_back(b);
+    }
+
+    tid_block &b = _blocks.back();
+    if (b.count == b.cap) {
+      b.rows = _arena.extend(b.rows, b.cap, 2 * b.cap);
+      b.cap *= 2;
+    }
+    return b.rows + b.count++;
+  }
+
+  /** Takes back the last row appended; an emptied block is dropped */
+  void drop_last_row() {
+    if (--_blocks.back().count == 0) {
+      _tids.pop_back(_blocks.back().tid);
+      _blocks.pop_back();
+    }
+  }
+
+  /** The ne edges es, as written by get_row(), as sorted pairs in out */
+  static void sorted_edges(const int *es, const unsigned int &ne,
+                           vector<pair<int, int>> &out) {
+    out.resize(ne);
+    for (unsigned int k = 0; k < ne; k++)
+      out[k] = make_pair(es[2 * k], es[2 * k + 1]);
+    sort(out.begin(), out.end());
+  }
+
+  /** True if the edge a-b, in either direction, is among the ne edges es */
+  static bool has_edge(const int *es, const unsigned int &ne, const int &a,
+                       const int &b) {
+    for (unsigned int k = 0; k < ne; k++)
+      if ((es[2 * k] == a && es[2 * k + 1] == b) ||
+          (es[2 * k] == b && es[2 * k + 1] == a))
+        return true;
+    return false;
+  }
+
+  unsigned int _nv;                  // vertices per embedding
+  unsigned int _ne;                  // edges per embedding
+  std::shared_ptr<const VAT> _parent; // null at level one
+  BLOCKS _blocks;                    // one block per tid, in tid order
+  tid_bitset _tids;                  // tids of _blocks
+  incidence_index _inc;              // level one only: rows by end vertex
+  bump_arena<link> _arena;
+
+}; // end class vat for graphs, linked layout
+
+template <typename PP, typename MP>
+struct shared_vats_only<vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage>>
+    : std::true_type {};
+
+/**
+ * Output the VAT object, in the same format as the std::vector graph VAT
+ */
+template <typename PP, typename MP>
+ostream &operator<<(ostream &ostr,
+                    const vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage> *v) {
+  typedef vat<GRAPH_PROP, V_Fk1_MINE_PROP, linked_storage> VAT;
+
+  vector<int> vs(v->_nv), flat(2 * v->_ne);
+  vector<pair<int, int>> es;
+  cout << "***** Printing candidate patterns vat." << endl;
+  for (typename VAT::CONST_IT it = v->begin(); it != v->end(); it++) {
+    cout << "Tid = " << it->tid << endl;
+
+    for (unsigned int i = 0; i < it->count; i++) {
+      v->get_row(*it, i, vs.data(), flat.data());
+      VAT::sorted_edges(flat.data(), v->_ne, es);
+
+      cout << "[";
+      for (unsigned int w = 0; w < v->_nv; w++) {
+        if (w != 0)
+          cout << ";" << vs[w];
+        else
+          cout << vs[w];
+      }
+      cout << "]\t[";
+
+      for (unsigned int k = 0; k < v->_ne; k++) {
+        if (k != 0)
+          cout << ";";
+        cout << "(" << es[k].first << "-->" << es[k].second << ")";
+      }
+      cout << "]\n";
+    }
+  }
+  cout << "***** Finished printing candidate patterns vat." << endl;
+
+  return ostr;
+} // operator<< for vat*
+
+#endif
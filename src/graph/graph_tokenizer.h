@@ -24,11 +24,15 @@
 #include "StringTokenizer.h"
 #include "element_parser.h"
 #include "generic_classes.h"
+#include "graph_bin_format.h"
 #include "graph_vat.h"
+#include "mapped_file.h"
 #include "tokenizer_utils.h"
+#include "trans_graphs.h"
 #include "typedefs.h"
 #include <fstream>
 #include <iostream>
+#include <set>
 #include <string>
 
 using namespace std;
@@ -62,25 +66,29 @@ public:
       typename GRAPH_PATTERN::EDGE_T>
       MAP_EDGE_T;
   typedef map<MAP_EDGE_T, int> FREQ_MAP;
+  typedef trans_graphs<typename GRAPH_PATTERN::VERTEX_T,
+                       typename GRAPH_PATTERN::EDGE_T>
+      TRANS_DB;
   tokenizer(const int max = LINE_SZ)
-      : MAXLINE(max) {} /**<constructor for tokenizer */
+      : MAXLINE(max), _trans_db(0) {} /**<constructor for tokenizer */
 
-  /** \fn int parse_next_trans(ifstream& infile, pat_fam<PATTERN>& freq_pats,
+  /** Also adds every transaction parsed to db; 0 turns this off */
+  void keep_trans(TRANS_DB *db) { _trans_db = db; }
+
+  /** \fn int parse_next_trans(istream& infile, pat_fam<PATTERN>& freq_pats,
    * vat_db<PATTERN, VAT>& vat_hmap) returns the TID of transaction read; parses
    * one transaction from input database, and collects VATS in vat_hmap return
    * value is -1 on end of stream
    */
-  template <class SM_T>
-  int parse_next_trans(ifstream &infile, pat_fam<GRAPH_PATTERN> &freq_pats,
-                       storage_manager<GRAPH_PATTERN, VAT, SM_T> &vat_hmap,
+  template <class SM_T, class VAT_T>
+  int parse_next_trans(istream &infile, pat_fam<GRAPH_PATTERN> &freq_pats,
+                       storage_manager<GRAPH_PATTERN, VAT_T, SM_T> &vat_hmap,
                        FREQ_MAP &fm) {
     std::string word;
 
     int lineno = 0;
     int tid = -1;
-    int pos; // stores starting position of input stream's get pointer
-    VAT *gvat;
-    GRAPH_PATTERN *g1 = 0;
+    streampos pos; // stores starting position of input stream's get pointer
     FREQ_MAP local_fm;
 
     map<int, typename GRAPH_PATTERN::VERTEX_T> vid_to_lbl; // map from vertex-id
@@ -88,6 +96,7 @@ public:
     typename map<int, typename GRAPH_PATTERN::VERTEX_T>::iterator tmp_it;
     typename GRAPH_PATTERN::EDGE_T e_lbl;
     typename GRAPH_PATTERN::VERTEX_T v_lbl1, v_lbl2;
+    typename TRANS_DB::EDGES edges; // kept only for _trans_db
 
     std::string line; // holds a line, while reading a file
     // read every single line
@@ -97,6 +106,8 @@ public:
       std::getline(infile, line); // reading a line
       if (line.length() < 1) {    // file ended, returning current tid
         map_update(fm, local_fm);
+        if (_trans_db && tid != -1)
+          _trans_db->add_trans(tid, vid_to_lbl, edges);
         return tid;
       }
 
@@ -114,6 +125,8 @@ public:
         if (tid != -1) {      // this is a new tid, stop here
           infile.seekg(pos);
           map_update(fm, local_fm);
+          if (_trans_db)
+            _trans_db->add_trans(tid, vid_to_lbl, edges);
           return tid; // this is the line from where function should
                       // return on most calls
         }
@@ -154,7 +167,6 @@ public:
         v_lbl1 = vid_to_lbl.find(vid1)->second;
         v_lbl2 = vid_to_lbl.find(vid2)->second;
         e_lbl = edge_prsr.parse_element(tokens[3]);
-        bool swap_vids; // flag=false if v_lbl1<v_lbl2
 
         /// INPUT-FORMAT: if the datafile format is to append
         /// edge labels with a letter (as is true for data
@@ -163,101 +175,10 @@ public:
         /// above line to:
         /// e_lbl=el_prsr.parse_element(word+1);
 
-        /// prepare pattern ///
-        g1 = new GRAPH_PATTERN;
-        if (v_lbl1 <= v_lbl2) {
-          make_edge(g1, v_lbl1, v_lbl2, e_lbl);
-          swap_vids = 0;
-        } else {
-          make_edge(g1, v_lbl2, v_lbl1, e_lbl);
-          swap_vids = 1;
-        }
-
-        /// if g1's vat is present, check if this tid is also
-        /// present. If yes, then insert pair of vids.
-        /// If tid not present, create a new entry in vat and
-        /// insert it
-
-        if (!(gvat = vat_hmap.get_vat(g1))) { // vat not found
-          gvat = new VAT;
-          if (!swap_vids) {
-            gvat->insert_occurrence_tid(tid, make_pair(vid1, vid2));
-            gvat->insert_vid_tid(tid, vid1);
-            gvat->insert_vid(vid2);
-
-            // If the labels are the same then add the
-            // both ways.
-            if (v_lbl1 == v_lbl2) {
-              gvat->insert_occurrence(make_pair(vid2, vid1));
-              gvat->insert_vid_hs(vid2);
-              gvat->insert_vid(vid1);
-            }
-
-          } else {
-            gvat->insert_occurrence_tid(tid, make_pair(vid2, vid1));
-            gvat->insert_vid_tid(tid, vid2);
-            gvat->insert_vid(vid1);
-          }
-
-          vat_hmap.add_vat(g1, gvat); // add pattern-vat mapping
-          freq_pats.push_back(
-              g1); // this is the first time
-                   // this pattern has been encountered, so add it
-        } else if (gvat->back().first != tid) { // or, new tid
-          if (!swap_vids) {
-            gvat->insert_occurrence_tid(tid, make_pair(vid1, vid2));
-            gvat->insert_vid_tid(tid, vid1);
-            gvat->insert_vid(vid2);
-
-            if (v_lbl1 == v_lbl2) {
-              gvat->insert_occurrence(make_pair(vid2, vid1));
-              gvat->insert_vid_hs(vid2);
-              gvat->insert_vid(vid1);
-            }
-
-          } else {
-            gvat->insert_occurrence_tid(tid, make_pair(vid2, vid1));
-            gvat->insert_vid_tid(tid, vid2);
-            gvat->insert_vid(vid1);
-          }
-
-          if (g1) {
-            delete g1;
-            g1 = 0;
-          }
-        } else { // assert: gvat->back().first=tid
-          MAP_EDGE_T edge;
-          if (!swap_vids) {
-            edge = make_pair(make_pair(v_lbl1, v_lbl2), e_lbl);
-            gvat->insert_occurrence(make_pair(vid1, vid2));
-            gvat->insert_vid_hs(vid1);
-            gvat->insert_vid(vid2);
-
-            if (v_lbl1 == v_lbl2) {
-              gvat->insert_occurrence(make_pair(vid2, vid1));
-              gvat->insert_vid_hs(vid2);
-              gvat->insert_vid(vid1);
-            }
-          } else {
-            edge = make_pair(make_pair(v_lbl2, v_lbl1), e_lbl);
-
-            gvat->insert_occurrence(make_pair(vid2, vid1));
-            gvat->insert_vid_hs(vid2);
-            gvat->insert_vid(vid1);
-          }
-
-          typename FREQ_MAP::iterator mit = local_fm.find(edge);
-          if (mit == local_fm.end()) { // this edge is not added
-            local_fm.insert(mit, make_pair(edge, 2));
-          } else {
-            mit->second++;
-          }
-
-          if (g1) {
-            delete g1;
-            g1 = 0;
-          }
-        }
+        add_edge(tid, vid1, vid2, v_lbl1, v_lbl2, e_lbl, (VAT_T *)0, freq_pats,
+                 vat_hmap, local_fm);
+        if (_trans_db)
+          edges.push_back(make_pair(make_pair(vid1, vid2), e_lbl));
 
       } else {
         cerr << "graph.tokenizer.parse_next_trans: Unidentifiable line=" << line
@@ -270,7 +191,231 @@ public:
 
   } // parse_next_trans()
 
+  /** True if the label parsers keep a dictionary that wants the labels of
+   * the database before it is parsed, see add_labels() */
+  static bool keeps_dict() {
+    return element_parser<typename GRAPH_PATTERN::VERTEX_T>::keeps_dict ||
+           element_parser<typename GRAPH_PATTERN::EDGE_T>::keeps_dict;
+  }
+
+  /**
+   * Hands the vertex and edge labels of the ASCII database in [b, e) to the
+   * label parsers, in one batch so that their ids follow text order. Like
+   * parse_next_trans(), stops at the first empty line.
+   */
+  static void add_labels(const char *b, const char *e) {
+    std::set<std::string> labels;
+    const char *p = b;
+    while (p < e && *p != '\n') {
+      const char *eol = static_cast<const char *>(memchr(p, '\n', e - p));
+      if (!eol)
+        eol = e;
+      const char *end = eol;
+      while (end > p && *(end - 1) == ' ')
+        end--;
+      if (end - p > 2 && (*p == 'v' || *p == 'e') && p[1] == ' ') {
+        const char *lbl = end; // the label is the last token
+        while (lbl > p && *(lbl - 1) != ' ')
+          lbl--;
+        labels.insert(std::string(lbl, end));
+      }
+      p = eol + 1;
+    }
+    add_labels(vector<std::string>(labels.begin(), labels.end()));
+  }
+
+  /** True if the mapped file holds a binary graph database */
+  static bool is_binary(const mapped_file &db) {
+    return graph_bin_db::is_bin(db.data(), db.size());
+  }
+
+  /** Prepares reading the binary database db with parse_next_trans(); the
+   * label dictionaries are parsed once here */
+  bool open_binary(const mapped_file &db) {
+    if (!_bin_db.open(db.data(), db.size()))
+      return false;
+
+    const vector<std::string> &vl = _bin_db.vertex_labels();
+    const vector<std::string> &el = _bin_db.edge_labels();
+    if (keeps_dict()) {
+      vector<std::string> labels(vl);
+      labels.insert(labels.end(), el.begin(), el.end());
+      add_labels(labels);
+    }
+
+    _bin_vlbls.clear();
+    for (unsigned int i = 0; i < vl.size(); i++)
+      _bin_vlbls.push_back(el_prsr.parse_element(vl[i]));
+
+    _bin_elbls.clear();
+    for (unsigned int i = 0; i < el.size(); i++)
+      _bin_elbls.push_back(edge_prsr.parse_element(el[i]));
+    return true;
+  }
+
+  /** Number of transactions in the database set up by open_binary() */
+  unsigned int num_binary_trans() const { return _bin_db.num_trans(); }
+
+  /** Label ids of a single-edge pattern in a binary database */
+  struct label_triple {
+    uint32_t first, second, third;
+    label_triple(uint32_t a, uint32_t b, uint32_t c)
+        : first(a), second(b), third(c) {}
+    bool operator<(const label_triple &o) const {
+      if (first != o.first)
+        return first < o.first;
+      if (second != o.second)
+        return second < o.second;
+      return third < o.third;
+    }
+  };
+
+  /** Level-one VAT of each labelled edge read from a binary database, kept
+   * by the caller from one parse_next_trans() to the next */
+  template <class VAT_T> using BIN_VATS = map<label_triple, VAT_T *>;
+
+  /**
+   * Binary counterpart of the ASCII parse_next_trans(): reads the transaction
+   * at position next of the database set up by open_binary(), and advances
+   * next. Returns its tid, or -1 once all transactions were read or on a bad
+   * record. The VAT of each labelled edge is looked up in vat_hmap only
+   * once, then found in l1_vats; l1_vats is cleared whenever -1 is returned,
+   * since the level-one VATs may be deleted from then on.
+   */
+  template <class SM_T, class VAT_T>
+  int parse_next_trans(unsigned int &next, pat_fam<GRAPH_PATTERN> &freq_pats,
+                       storage_manager<GRAPH_PATTERN, VAT_T, SM_T> &vat_hmap,
+                       FREQ_MAP &fm, BIN_VATS<VAT_T> &l1_vats) {
+    int tid = parse_bin_trans(next, freq_pats, vat_hmap, fm, l1_vats);
+    if (tid == -1)
+      l1_vats.clear();
+    return tid;
+  }
+
 private: // private local methods, not exposed to outside
+  /** Reads the binary transaction at next, see parse_next_trans() */
+  template <class SM_T, class VAT_T>
+  int parse_bin_trans(unsigned int &next, pat_fam<GRAPH_PATTERN> &freq_pats,
+                      storage_manager<GRAPH_PATTERN, VAT_T, SM_T> &vat_hmap,
+                      FREQ_MAP &fm, BIN_VATS<VAT_T> &l1_vats) {
+    if (next >= _bin_db.num_trans())
+      return -1;
+
+    graph_bin_db::trans t;
+    if (!_bin_db.get_trans(next, t)) {
+      cerr << "graph_tokenizer.parse_next_trans: bad record for transaction "
+           << next << endl;
+      return -1;
+    }
+    next++;
+
+    FREQ_MAP local_fm;
+    for (uint32_t e = 0; e < t.ne; e++) {
+      const uint32_t *edge = t.edges + 3 * e;
+      if (edge[0] >= t.nv || edge[1] >= t.nv ||
+          edge[2] >= _bin_elbls.size() || t.vlbls[edge[0]] >= _bin_vlbls.size() ||
+          t.vlbls[edge[1]] >= _bin_vlbls.size()) {
+        cerr << "graph_tokenizer.parse_next_trans: bad edge in transaction "
+             << t.tid << endl;
+        return -1;
+      }
+
+      label_triple key(t.vlbls[edge[0]], t.vlbls[edge[1]], edge[2]);
+      typename BIN_VATS<VAT_T>::iterator it = l1_vats.find(key);
+      VAT_T *gvat = (it == l1_vats.end()) ? 0 : it->second;
+
+      VAT_T *added = add_edge(t.tid, t.vids[edge[0]], t.vids[edge[1]],
+                              _bin_vlbls[key.first], _bin_vlbls[key.second],
+                              _bin_elbls[key.third], gvat, freq_pats, vat_hmap,
+                              local_fm);
+      if (!gvat)
+        l1_vats.insert(make_pair(key, added));
+    }
+    map_update(fm, local_fm);
+    if (_trans_db)
+      add_bin_trans(t);
+    return t.tid;
+  }
+
+  /** Adds the binary transaction t, whose edges were checked, to _trans_db */
+  void add_bin_trans(const graph_bin_db::trans &t) {
+    map<int, typename GRAPH_PATTERN::VERTEX_T> vid_to_lbl;
+    for (uint32_t v = 0; v < t.nv; v++)
+      if (t.vlbls[v] < _bin_vlbls.size())
+        vid_to_lbl.insert(make_pair(t.vids[v], _bin_vlbls[t.vlbls[v]]));
+    typename TRANS_DB::EDGES edges;
+    for (uint32_t e = 0; e < t.ne; e++) {
+      const uint32_t *edge = t.edges + 3 * e;
+      edges.push_back(make_pair(make_pair(t.vids[edge[0]], t.vids[edge[1]]),
+                                _bin_elbls[edge[2]]));
+    }
+    _trans_db->add_trans(t.tid, vid_to_lbl, edges);
+  }
+
+  /**
+   * Adds the edge vid1-vid2 of transaction tid, labelled v_lbl1, v_lbl2 and
+   * e_lbl, to the VAT of its single-edge pattern. gvat is that VAT if the
+   * caller knows it, else 0; the pattern and its VAT are created on the first
+   * occurrence of the edge. Returns the VAT.
+   */
+  template <class SM_T, class VAT_T>
+  VAT_T *add_edge(const int &tid, const int &vid1, const int &vid2,
+                  const typename GRAPH_PATTERN::VERTEX_T &v_lbl1,
+                  const typename GRAPH_PATTERN::VERTEX_T &v_lbl2,
+                  const typename GRAPH_PATTERN::EDGE_T &e_lbl, VAT_T *gvat,
+                  pat_fam<GRAPH_PATTERN> &freq_pats,
+                  storage_manager<GRAPH_PATTERN, VAT_T, SM_T> &vat_hmap,
+                  FREQ_MAP &local_fm) {
+    bool swap_vids = !(v_lbl1 <= v_lbl2); // the smaller label goes first
+
+    if (!gvat) {
+      /// prepare pattern ///
+      GRAPH_PATTERN *g1 = new GRAPH_PATTERN;
+      if (!swap_vids)
+        make_edge(g1, v_lbl1, v_lbl2, e_lbl);
+      else
+        make_edge(g1, v_lbl2, v_lbl1, e_lbl);
+
+      if (!(gvat = vat_hmap.get_vat(g1))) { // vat not found
+        gvat = new VAT_T;
+        vat_hmap.add_vat(g1, gvat); // add pattern-vat mapping
+        freq_pats.push_back(g1);    // this is the first time
+                                    // this pattern has been encountered
+      } else {
+        delete g1;
+      }
+    }
+
+    /// if the tid is already in g1's vat, the edge occurs more than once
+    /// in this transaction; count it for the edge frequency map
+    if (!gvat->empty() && gvat->last_tid() == tid) {
+      MAP_EDGE_T edge;
+      if (!swap_vids)
+        edge = make_pair(make_pair(v_lbl1, v_lbl2), e_lbl);
+      else
+        edge = make_pair(make_pair(v_lbl2, v_lbl1), e_lbl);
+
+      typename FREQ_MAP::iterator mit = local_fm.find(edge);
+      if (mit == local_fm.end()) { // this edge is not added
+        local_fm.insert(mit, make_pair(edge, 2));
+      } else {
+        mit->second++;
+      }
+    }
+
+    if (!swap_vids) {
+      gvat->insert_edge(tid, vid1, vid2);
+
+      // If the labels are the same then add the
+      // both ways.
+      if (v_lbl1 == v_lbl2)
+        gvat->insert_edge(tid, vid2, vid1);
+    } else {
+      gvat->insert_edge(tid, vid2, vid1);
+    }
+    return gvat;
+  }
+
   void map_update(FREQ_MAP &global, const FREQ_MAP &local) {
     typename FREQ_MAP::iterator git;
     typename FREQ_MAP::const_iterator it;
@@ -287,11 +432,22 @@ private: // private local methods, not exposed to outside
   }
 
 private:
+  // vertex and edge labels may share a dictionary, so both get all of them
+  static void add_labels(const vector<std::string> &labels) {
+    element_parser<typename GRAPH_PATTERN::VERTEX_T>::add_labels(labels);
+    element_parser<typename GRAPH_PATTERN::EDGE_T>::add_labels(labels);
+  }
+
   int MAXLINE; /**< max length of line to be parsed */
   element_parser<typename GRAPH_PATTERN::VERTEX_T>
       el_prsr; /**< parses an element of desired type */
   element_parser<typename GRAPH_PATTERN::EDGE_T>
       edge_prsr; /**< parses an element of desired type */
+
+  graph_bin_db _bin_db; /**< binary database being read, if any */
+  vector<typename GRAPH_PATTERN::VERTEX_T> _bin_vlbls; /**< parsed labels */
+  vector<typename GRAPH_PATTERN::EDGE_T> _bin_elbls;
+  TRANS_DB *_trans_db; /**< transactions are kept here, if set */
 }; // end class tokenizer
 
 #endif
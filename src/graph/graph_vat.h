@@ -20,9 +20,14 @@
 #ifndef _GRAPH_VAT_H
 #define _GRAPH_VAT_H
 
+#include "alloc_policy.h"
+#include "embedding_set.h"
 #include "generic_classes.h"
 #include "helper_funs.h"
+#include "incidence_index.h"
+#include "metrics.h"
 #include "pattern.h"
+#include "tid_bitset.h"
 #include "time_tracker.h"
 #include "typedefs.h"
 #include <algorithm>
@@ -30,9 +35,6 @@
 #include <unordered_map>
 #include <unordered_set>
 
-// time_tracker tt_vat, tt_fwd_isect, tt_back_isect;
-template <typename T> using ALLOC = std::allocator<T>;
-
 template <typename PP, typename MP, template <typename, typename> class ST>
 class vat<GRAPH_PROP, V_Fk1_MINE_PROP, ST>;
 
@@ -49,7 +51,10 @@ ostream &operator<<(ostream &ostr, const vat<PP, MP, ST> *v);
  * In this partial specialization, PP is fixed to undirected (undirected graph
  * property), MP is fixed to Fk X F1 and vert_mine (vertical mining with FK X
  * F1), ST is the VAT storage type. For graph, ST should model a vector, else
- * this shall not compile.
+ * this shall not compile. The tids are also kept in a tid_bitset, from which
+ * intersection() counts and finds the common tids. Level-one VATs also index
+ * their occurrences by end vertex (incidence_index), which the intersections
+ * look up rather than scanning all the edges of a transaction.
  */
 
 template <typename PP, typename MP, template <typename, typename> class ST>
@@ -82,16 +87,11 @@ public:
   typedef typename DS_VSETS::const_iterator CONST_VS_IT;
 
   void *operator new(size_t size) {
-    ALLOC<VAT> v;
-    return v.allocate(size);
+    metrics::add(metrics::VAT_ALLOC);
+    return alloc_bytes<ALLOC>(size);
   }
 
-  void operator delete(void *p, size_t size) {
-    if (p) {
-      ALLOC<VAT> v;
-      v.deallocate(static_cast<VAT *>(p), size);
-    }
-  }
+  void operator delete(void *p, size_t size) { free_bytes<ALLOC>(p, size); }
 
   IT begin() { return _vat.begin(); }
   CONST_IT begin() const { return _vat.begin(); }
@@ -111,10 +111,40 @@ public:
 
   const pair<int, EDGE_SETS> &back() const { return _vat.back(); }
 
+  /** Tid of the last transaction in the VAT */
+  int last_tid() const { return _vat.back().first; }
+
+  const tid_bitset &tids() const { return _tids; }
+
+  /** Number of vertices of each embedding */
+  unsigned int num_vertices() const {
+    return _vids.empty() ? 0 : _vids.front().second.front().size();
+  }
+
   /*
    * The following insert_* functions are only used from graph_tokenizer.h
    */
 
+  // Insert an occurrence of a single-edge pattern, the edge (vid1, vid2) of
+  // transaction tid.
+  void insert_edge(const int &tid, const int &vid1, const int &vid2) {
+    if (_vat.empty() || _vat.back().first != tid) {
+      insert_occurrence_tid(tid, make_pair(vid1, vid2));
+      insert_vid_tid(tid, vid1);
+    } else {
+      insert_occurrence(make_pair(vid1, vid2));
+      insert_vid_hs(vid1);
+    }
+    insert_vid(vid2);
+    _inc.add(_vids.size() - 1, vid1, vid2, _vids.back().second.size() - 1);
+  }
+
+  /**
+   * Completes the VAT once all its embeddings are inserted; done by db_reader
+   * for every level-one VAT it keeps, before any is intersected.
+   */
+  void finish() { _inc.finish(); }
+
   // Insert the first edge of an occurrence for the tid.
   void insert_occurrence_tid(const int &tid,
                              const pair<int, int> &new_occurrence) {
@@ -124,6 +154,7 @@ public:
     new_edge_set.insert(new_occurrence);
     new_edge_sets.push_back(new_edge_set);
     _vat.push_back(make_pair(tid, new_edge_sets));
+    _tids.push_back(tid);
   } // insert_new_occurrence()
 
   /**
@@ -184,34 +215,23 @@ public:
       it++;
     }
   }
+  /**
+   * Calls f(tid, vids) for every embedding, in tid order; vids points to the
+   * ids of the vertices of the embedding, one per pattern vertex.
+   */
+  template <typename FUNC> void for_each_embedding(FUNC f) const {
+    for (CONST_VS_IT it = begin_v(); it != end_v(); it++)
+      for (unsigned int i = 0; i < it->second.size(); i++)
+        f(it->first, it->second[i].data());
+  }
+
   /**
    *
    */
   static double get_tid_distance(const VAT *v1, const VAT *v2) {
-    cout << "In get_tid_distance\n";
-    CONST_IT it_v1 = v1->begin();
-    CONST_IT it_v2 = v2->begin();
-    unsigned int intersection_size = 0;
-    while (it_v1 != v1->end() && it_v2 != v2->end()) {
-      if (it_v1->first < it_v2->first) {
-        cout << it_v1->first << " " << it_v2->first << endl;
-        it_v1++;
-        continue;
-      }
-
-      if (it_v1->first > it_v2->first) {
-        cout << it_v1->first << " " << it_v2->first << endl;
-        it_v2++;
-        continue;
-      }
-      intersection_size++;
-      cout << "Match:";
-      cout << it_v1->first << " " << it_v2->first << endl;
-      it_v1++;
-      it_v2++;
-    }
+    unsigned int intersection_size =
+        tid_bitset::count_common(v1->_tids, v2->_tids);
     unsigned int union_size = v1->size() + v2->size() - intersection_size;
-    cout << "Out get_tid_distance\n";
     return 1.0 - (double)intersection_size / union_size;
   }
 
@@ -231,94 +251,27 @@ public:
     cout << "v2=" << v2 << endl;
 #endif
 
+    // Count the common tids on the bitsets. If the count is less than
+    // min_sup, then no need to even go through fwd and back intersects.
+    if ((int)tid_bitset::count_common(v1->_tids, v2->_tids) < minsup)
+      return NULL;
+
     VAT *cand_vat = new VAT;
     VAT **cand_vats = new VAT *;
     cand_vats[0] = cand_vat;
 
-    CONST_IT it_v1 = v1->begin();
-    CONST_IT it_v2 = v2->begin();
-
-    int common_cnt = 0;
-    // Find the number of common tids. If the count is
-    // less than min_sup, then no need to even go through
-    // fwd and back intersects.
-    while (it_v1 != v1->end() && it_v2 != v2->end()) {
-      if (it_v1->first < it_v2->first) {
-        it_v1++;
-        continue;
-      }
-
-      if (it_v1->first > it_v2->first) {
-        it_v2++;
-        continue;
-      }
-
-      it_v1++;
-      it_v2++;
-      common_cnt++;
-    }
-
-    if (common_cnt < minsup) {
-      // cout << "Leaving intersection 2.." << endl;
-      delete cand_vat;
-      delete cand_vats;
-      return NULL;
-    }
-    // cout << "Number of common tids = " << common_cnt << endl;
-
-    it_v1 = v1->begin();
-    it_v2 = v2->begin();
-    // int v1_rem = v1->end() - v1->begin();
-    // int v2_rem = v2->end() - v2->begin();
-    int rem_sup = minsup;
-
-    while (it_v1 != v1->end() && it_v2 != v2->end()) { // find a common TID
-
-      // If the minimum number of transactions left is less than
-      // the number of transactions required to meet min_sup.
-      if (rem_sup > min(v1->end() - it_v1, v2->end() - it_v2)) {
-        delete cand_vat;
-        delete cand_vats;
-        return NULL;
-      }
-
-      if (it_v1->first < it_v2->first) {
-        it_v1++;
-        continue;
-      }
-
-      if (it_v1->first > it_v2->first) {
-        it_v2++;
-        continue;
-      }
-
-      // Decrement the count of number of tids remaining.
-      rem_sup--;
-
-      /// we now have both evats, intersect them ///
-      // the intersection routines are expected to fill in the new evat in
-      // cand_vat
-      int v1_idx = it_v1 - v1->begin();
-      int v2_idx = it_v2 - v2->begin();
-      // cout << "---------------------------------------------------" << endl;
-      if (isfwd) {
-        time_tracker tt_fwd_isect;
-        tt_fwd_isect.start();
-        fwd_intersect(v1, v1_idx, v2, v2_idx, vids, cand_vat);
-        tt_fwd_isect.stop();
-        // cout << "Time for fwd_intersect = " << tt_fwd_isect.print() << endl;
-      } else {
-        time_tracker tt_back_isect;
-        tt_back_isect.start();
-        back_intersect(v1, v1_idx, v2, v2_idx, vids, cand_vat);
-        tt_back_isect.stop();
-        // cout << "Time for back_intersect = " << tt_back_isect.print() <<
-        // endl;
-      }
-
-      it_v1++;
-      it_v2++;
-    } // end while
+    /// we now have both evats, intersect them ///
+    // the intersection routines are expected to fill in the new evat in
+    // cand_vat; the ranks of a common tid are its indices in both VATs
+    tid_bitset::for_common(v1->_tids, v2->_tids,
+                           [&](unsigned int, int v1_idx, int v2_idx) {
+                             if (isfwd)
+                               fwd_intersect(v1, v1_idx, v2, v2_idx, vids,
+                                             cand_vat);
+                             else
+                               back_intersect(v1, v1_idx, v2, v2_idx, vids,
+                                              cand_vat);
+                           });
 
     cand_sups[0]->set_sup(make_pair(cand_vat->size(), 0));
 
@@ -328,6 +281,36 @@ public:
     return cand_vats;
   } // end intersect()
 
+  /**
+   * Batched intersection, with the arguments of the arena layout's: candidate
+   * c adds the edge of v2 from pattern vertex src to dests[c], a new vertex
+   * when dests[c] is the number of vertices of v1. This layout intersects
+   * the candidates one at a time. Returns their num VATs, or NULL when all
+   * are null or the tids leave none of them frequent.
+   */
+  template <typename PATTERN, typename PAT_SUP>
+  static VAT **intersection(const VAT *v1, const VAT *v2, PAT_SUP **cand_sups,
+                            PATTERN **cand_pats, const int &num,
+                            const int &src, const int *dests,
+                            const int &minsup) {
+    if (std::count(cand_pats, cand_pats + num, (PATTERN *)0) == num ||
+        (int)tid_bitset::count_common(v1->_tids, v2->_tids) < minsup)
+      return NULL;
+
+    VAT **cand_vats = new VAT *[num];
+    for (int c = 0; c < num; c++) {
+      cand_vats[c] = 0;
+      if (!cand_pats[c])
+        continue;
+      VAT **one = intersection(v1, v2, cand_sups + c, cand_pats + c,
+                               dests[c] == (int)v1->num_vertices(),
+                               make_pair(src, dests[c]), minsup);
+      cand_vats[c] = one[0];
+      delete one; // a single slot
+    }
+    return cand_vats;
+  } // end intersect()
+
   /**
    * For a given transaction, go over all VSETS and
    * look for matches between the two VATs.
@@ -351,12 +334,10 @@ public:
 
     int tid = (v2->_vids)[v2_idx].first;
 
-    // typedef HASHNS::hash_set<const char*, HASHNS::hash<const char*>, eqstr >
-    // ES_STR_SET;
-    typedef set<string> ES_STR_SET;
-
-    // Keeps a string representation of each embedding.
-    ES_STR_SET edge_set_map;
+    // Keeps the edge set of each embedding added for this tid.
+    static thread_local embedding_set edge_set_map;
+    if (!es1.empty())
+      edge_set_map.reset(2 * (es1[0].size() + 1));
 
     // For each VSETS (embedding) in this transaction.
     for (unsigned int i = 0; i < vs1.size(); i++) {
@@ -372,16 +353,12 @@ public:
 #endif
 
       // Each vertex set in the transaction graph
-      // for which the tids matched.
-      for (unsigned int j = 0; j < vs2.size(); j++) {
-        const VSET &vs2_inst = vs2[j];
-
-        if (vs2_inst[0] == mapped_v)
-          other_v = vs2_inst[1];
-        else if (vs2_inst[1] == mapped_v)
-          other_v = vs2_inst[0];
-        else
-          continue;
+      // for which the tids matched, with an end at mapped_v.
+      pair<incidence_index::CONST_IT, incidence_index::CONST_IT> at =
+          v2->_inc.find(v2_idx, mapped_v);
+      for (incidence_index::CONST_IT e = at.first; e != at.second; e++) {
+        const VSET &vs2_inst = vs2[e->second];
+        other_v = vs2_inst[0] == mapped_v ? vs2_inst[1] : vs2_inst[0];
 
         VSET::const_iterator itr =
             find(vs1_inst.begin(), vs1_inst.end(), other_v);
@@ -392,19 +369,13 @@ public:
 
           // fnd = true;
 
-          E_SET cand_es = es1[i];
-          cand_es.insert(make_pair(mapped_v, other_v));
-
-          std::string es_str = edge_set_to_string(cand_es);
-          // char* es_cs = new char[es_str.size()+1];
-          // strcpy(es_cs, es_str.c_str());
-          if (edge_set_map.find(es_str) != edge_set_map.end()) {
-            // delete [] es_cs;
-            continue;
-          } else {
-            edge_set_map.insert(es_str);
-          }
+          pair<int, int> new_edge(mapped_v, other_v);
+          edge_set_map.make_key(es1[i], new_edge);
+          if (!edge_set_map.insert_key())
+            continue; // this embedding was already added
 
+          E_SET cand_es = es1[i];
+          cand_es.insert(new_edge);
           c_vat->copy_edge_set(cand_es, tid);
 
           // Copy the vset into the cand vat.
@@ -497,10 +468,10 @@ public:
     int tid = (v2->_vids)[v2_idx].first;
     // bool fnd = false;
 
-    // typedef HASHNS::hash_set<const char*, HASHNS::hash<const char*>, eqstr >
-    // ES_STR_SET;
-    typedef set<string> ES_STR_SET;
-    ES_STR_SET edge_set_map;
+    // Keeps the edge set of each embedding added for this tid.
+    static thread_local embedding_set edge_set_map;
+    if (!es1.empty())
+      edge_set_map.reset(2 * (es1[0].size() + 1));
 
     // For each VSETS in this transaction.
     for (unsigned int i = 0; i < vs1.size(); i++) {
@@ -513,12 +484,14 @@ public:
       mapped_vid2 = vs1_inst[edge_vids.second];
 
       // Each vertex set in the transaction graph
-      // for which the tids matched.
-      for (unsigned int j = 0; j < vs2.size(); j++) {
-        const VSET &vs2_inst = vs2[j];
+      // for which the tids matched, with an end at mapped_vid1.
+      pair<incidence_index::CONST_IT, incidence_index::CONST_IT> at =
+          v2->_inc.find(v2_idx, mapped_vid1);
+      for (incidence_index::CONST_IT e = at.first; e != at.second; e++) {
+        const VSET &vs2_inst = vs2[e->second];
 
-        if ((vs2_inst[0] == mapped_vid1 && vs2_inst[1] == mapped_vid2) ||
-            (vs2_inst[1] == mapped_vid1 && vs2_inst[0] == mapped_vid2)) {
+        if ((vs2_inst[0] == mapped_vid1 ? vs2_inst[1] : vs2_inst[0]) ==
+            mapped_vid2) {
 
           if (es1[i].find(make_pair(mapped_vid1, mapped_vid2)) ==
                   es1[i].end() &&
@@ -527,20 +500,13 @@ public:
 
             // fnd = true;
 
-            E_SET cand_es = es1[i];
-            cand_es.insert(make_pair(mapped_vid1, mapped_vid2));
-
-            std::string es_str = edge_set_to_string(cand_es);
-            // char* es_cs = new char[es_str.size()+1];
-            // es_cs[es_str.size()] = '\0';
-            // strcpy(es_cs, es_str.c_str());
-            if (edge_set_map.find(es_str) != edge_set_map.end()) {
-              // delete [] es_cs;
-              continue;
-            } else {
-              edge_set_map.insert(es_str);
-            }
+            pair<int, int> new_edge(mapped_vid1, mapped_vid2);
+            edge_set_map.make_key(es1[i], new_edge);
+            if (!edge_set_map.insert_key())
+              continue; // this embedding was already added
 
+            E_SET cand_es = es1[i];
+            cand_es.insert(new_edge);
             c_vat->copy_edge_set(cand_es, tid);
 
             // Copy the vset into the cand vat.
@@ -664,11 +630,64 @@ public:
       EDGE_SETS ests;
       ests.push_back(cand_es);
       _vat.push_back(make_pair(tid, ests));
+      _tids.push_back(tid);
     } else if (_vat.back().first == tid) {
       _vat.back().second.push_back(cand_es);
     }
   }
 
+  /**
+   * Moves the embeddings of other to the end of this VAT; the tids of other
+   * must not be smaller than the last tid here.
+   */
+  void append(VAT &other) {
+    if (other._vat.empty())
+      return;
+
+    IT it = other._vat.begin();
+    VS_IT vit = other._vids.begin();
+    bool merge = !_vat.empty() && _vat.back().first == it->first;
+    _inc.append(other._inc, merge, merge ? _vids.back().second.size() : 0);
+    if (merge) { // same tid
+      EDGE_SETS &es = _vat.back().second;
+      VSETS &vs = _vids.back().second;
+      es.insert(es.end(), make_move_iterator(it->second.begin()),
+                make_move_iterator(it->second.end()));
+      vs.insert(vs.end(), make_move_iterator(vit->second.begin()),
+                make_move_iterator(vit->second.end()));
+      it++;
+      vit++;
+    }
+    for (IT t = it; t != other._vat.end(); t++)
+      _tids.push_back(t->first);
+    _vat.insert(_vat.end(), make_move_iterator(it),
+                make_move_iterator(other._vat.end()));
+    _vids.insert(_vids.end(), make_move_iterator(vit),
+                 make_move_iterator(other._vids.end()));
+    other._vat.clear();
+    other._vids.clear();
+    other._tids.clear();
+  }
+
+  /** Bytes taken by the embeddings, roughly: set nodes are counted as their
+   * value plus three pointers and a color */
+  unsigned long int byte_size() const {
+    const unsigned long int node = sizeof(pair<int, int>) + 4 * sizeof(void *);
+    unsigned long int sz = (_vat.capacity() + _vids.capacity()) *
+                           sizeof(pair<int, EDGE_SETS>);
+    for (CONST_IT it = begin(); it != end(); it++) {
+      sz += it->second.capacity() * sizeof(E_SET);
+      for (unsigned int k = 0; k < it->second.size(); k++)
+        sz += it->second[k].size() * node;
+    }
+    for (CONST_VS_IT it = begin_v(); it != end_v(); it++) {
+      sz += it->second.capacity() * sizeof(VSET);
+      for (unsigned int k = 0; k < it->second.size(); k++)
+        sz += it->second[k].capacity() * sizeof(int);
+    }
+    return sz + _tids.byte_size() + _inc.byte_size();
+  }
+
   /** Returns true if vid occurs in any of the offset-th vids in tid-th vat */
   bool is_new_vertex(const int &vid, const int &tid, const int &offset) const {
 
@@ -686,6 +705,8 @@ public:
 private:
   DS_EDGE_SETS _vat;
   DS_VSETS _vids;
+  tid_bitset _tids;     // tids of _vat
+  incidence_index _inc; // level one only: occurrences by end vertex
 
 }; // end class vat for graphs
 
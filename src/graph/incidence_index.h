@@ -0,0 +1,137 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _INCIDENCE_INDEX_H
+#define _INCIDENCE_INDEX_H
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Index of the embeddings of a level-one VAT by the vertices they
+ * touch, one sorted array per tid.
+ *
+ * Every embedding (row) of a single-edge pattern has two end vertices; the
+ * index holds a (vertex id, row) entry for each end, sorted within a tid, so
+ * the rows of a tid incident on a vertex are found by a binary search rather
+ * than by scanning all rows of the tid. Rows incident on the same vertex come
+ * in increasing row order, the order a scan would meet them in.
+ *
+ * The entries of all tids are stored back to back, with the offset of the
+ * first entry of each tid. The index is filled along with the VAT, by
+ * add() for every row inserted and by append() when VATs are merged, and only
+ * read afterwards. add() only appends; the entries of a tid are sorted once,
+ * when the next tid starts, so finish() must sort those of the last tid
+ * before the index is read.
+ */
+class incidence_index {
+public:
+  typedef std::pair<int, int> ENTRY; // vertex id, row
+  typedef const ENTRY *CONST_IT;
+
+  incidence_index() {}
+
+  /**
+   * Indexes row, with ends a and b, of the tid at rank block; block is the
+   * rank of the last tid indexed or the next one.
+   */
+  void add(const unsigned int &block, const int &a, const int &b,
+           const int &row) {
+    if (_off.empty())
+      _off.push_back(0);
+    if (block + 1 == _off.size()) {
+      finish();
+      _off.push_back(_off.back());
+    }
+    _entries.push_back(std::make_pair(a, row));
+    if (b != a)
+      _entries.push_back(std::make_pair(b, row));
+    _off.back() = _entries.size();
+  }
+
+  /**
+   * Sorts the entries of the last tid; rows come in increasing order, so
+   * the rows of a vertex stay in the order they were added.
+   */
+  void finish() {
+    if (_off.size() > 1)
+      std::sort(_entries.begin() + _off[_off.size() - 2], _entries.end());
+  }
+
+  /**
+   * Moves the entries of other to the end of this index. If merge is set,
+   * the first tid of other is the last tid here, whose shift rows come
+   * before those of other.
+   */
+  void append(incidence_index &other, const bool &merge, const int &shift) {
+    if (other._off.empty())
+      return;
+    if (_off.empty())
+      _off.push_back(0);
+    finish();
+    other.finish();
+    unsigned int k = 0, from = 0;
+    if (merge) {
+      unsigned int first = _off[_off.size() - 2];
+      for (; k < other._off[1]; k++)
+        _entries.push_back(std::make_pair(other._entries[k].first,
+                                          other._entries[k].second + shift));
+      std::sort(_entries.begin() + first, _entries.end());
+      _off.back() = _entries.size();
+      from = 1;
+    }
+    unsigned int e_shift = _entries.size() - k;
+    _entries.insert(_entries.end(), other._entries.begin() + k,
+                    other._entries.end());
+    for (unsigned int i = from + 1; i < other._off.size(); i++)
+      _off.push_back(other._off[i] + e_shift);
+
+    other._entries.clear();
+    other._off.clear();
+  }
+
+  /** Entries of the tid at rank block for the rows incident on vertex v */
+  std::pair<CONST_IT, CONST_IT> find(const unsigned int &block,
+                                     const int &v) const {
+    if (block + 1 >= _off.size())
+      return std::make_pair(CONST_IT(0), CONST_IT(0));
+    CONST_IT b = _entries.data() + _off[block];
+    CONST_IT e = _entries.data() + _off[block + 1];
+    b = std::lower_bound(b, e, std::make_pair(v, INT_MIN));
+    e = std::upper_bound(b, e, std::make_pair(v, INT_MAX));
+    return std::make_pair(b, e);
+  }
+
+  bool empty() const { return _entries.empty(); }
+
+  unsigned long int byte_size() const {
+    return _entries.capacity() * sizeof(ENTRY) +
+           _off.capacity() * sizeof(unsigned int);
+  }
+
+private:
+  std::vector<ENTRY> _entries;
+  // first entry of each tid, then the end; left empty until a row is added,
+  // so that the VATs of candidates pay nothing for the index
+  std::vector<unsigned int> _off;
+
+}; // end class incidence_index
+
+#endif
@@ -22,10 +22,12 @@
 
 #include "hash_utils.hpp"
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 using namespace std;
 template <typename P> class element_parser;
@@ -93,6 +95,9 @@ public:
 
   int size() const { return _hmap.size(); }
 
+  CONST_IT begin() const { return _hmap.begin(); }
+  CONST_IT end() const { return _hmap.end(); }
+
   int get_neighbors_count(const V_T &src) {
     typename V_EP::HASH_TYPE ret = V_EP::conv_hash_type(src);
     CNT_IT cnt_it = _cnt_map.find(ret);
@@ -233,4 +238,86 @@ private:
 
 }; // end class level_one_map
 
+/**
+ * \brief Read-only copy of a level_one_hmap, with the edges of each label in
+ * one contiguous array, for drawing random edges.
+ *
+ * Built once the level_one_hmap is complete. The edges at a label are the
+ * (neighbor label, edge label) pairs of the level_one_hmap, in the order it
+ * iterates them, so the k-th edge of a label is the one a walk over the
+ * neighbors and their label sets would reach after k steps; edge_at() finds
+ * it directly. Each edge also carries the id of its label triple (see
+ * edge_triples), as the walks key their bookkeeping by it.
+ */
+template <typename V_T, typename E_T> class level_one_csr {
+public:
+  typedef level_one_hmap<V_T, E_T> HMAP;
+
+  /** An edge at a label */
+  struct EDGE {
+    V_T dest;  // label of the neighbor
+    E_T e_lbl; // label of the edge
+    int id;    // of the label triple
+  };
+
+  /** Freezes l1map; triples must number all of its edges */
+  template <class TRIPLES>
+  level_one_csr(const HMAP &l1map, const TRIPLES &triples) {
+    for (typename HMAP::CONST_IT it = l1map.begin(); it != l1map.end(); it++) {
+      V_T src = it->first;
+      unsigned int first = _edges.size();
+      for (typename HMAP::CONST_NIT nit = it->second.begin();
+           nit != it->second.end(); nit++)
+        for (typename HMAP::CONST_LIT lit = nit->second.begin();
+             lit != nit->second.end(); lit++) {
+          EDGE x;
+          x.dest = nit->first;
+          x.e_lbl = *lit;
+          x.id = triples.id(src, x.dest, x.e_lbl);
+          if (x.id < 0) {
+            cout << "level_one_csr: edge (" << src << " " << x.e_lbl << " "
+                 << x.dest << ") has no triple id" << endl;
+            exit(1);
+          }
+          _edges.push_back(x);
+        }
+      _ranges.insert(
+          make_pair(src, make_pair(first, (unsigned int)_edges.size())));
+    }
+  }
+
+  /** Number of edges at label src, -1 if it has none */
+  int get_neighbors_count(const V_T &src) const {
+    typename RANGES::const_iterator it = _ranges.find(src);
+    if (it == _ranges.end())
+      return -1;
+    return it->second.second - it->second.first;
+  }
+
+  /** The edges at label src, get_neighbors_count(src) of them */
+  const EDGE *get_edges(const V_T &src) const {
+    typename RANGES::const_iterator it = _ranges.find(src);
+    if (it == _ranges.end()) {
+      cout << "level_one_csr.get_edges: src not found for src=" << src
+           << endl;
+      exit(0);
+    }
+    return _edges.data() + it->second.first;
+  }
+
+  /** The k-th edge at label src */
+  const EDGE &edge_at(const V_T &src, const unsigned int &k) const {
+    return get_edges(src)[k];
+  }
+
+private:
+  typedef std::unordered_map<V_T, pair<unsigned int, unsigned int>,
+                             myhash<V_T>>
+      RANGES;
+
+  vector<EDGE> _edges; // label by label
+  RANGES _ranges;      // [first, end) in _edges of each label
+
+}; // end class level_one_csr
+
 #endif
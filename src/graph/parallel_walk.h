@@ -0,0 +1,311 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+#ifndef _PARALLEL_WALK_H
+#define _PARALLEL_WALK_H
+
+#include "alloc_policy.h"
+#include "concurrent_pat_set.h"
+#include "pat_fam.h"
+#include "random_max-graph.h"
+#include "stop_policy.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \brief Runs random maximal walks on a pool of threads.
+ *
+ * Walks are independent of each other apart from the set of maximal patterns
+ * found so far, which is kept in a concurrent_pat_set. Every worker owns a
+ * count_support (CS) of its own, built from the storage manager that holds the
+ * level-one VATs; those VATs are only read during a walk. With memory_storage
+ * each worker gets a private copy of the pattern-to-VAT map, with
+ * concurrent_memory_storage all workers share one sharded map.
+ * Each worker also seeds its own random generator (see seed_randint()).
+ * The patterns of a walk come from the worker's walk arena (walk_scope), all
+ * released at once when the walk ends.
+ *
+ * The loop stops when the stop_policy given to run() says so: once enough
+ * maximal patterns were found, after enough walks in a row found none, when
+ * the estimated coverage gain per CPU-second gets too low, or at a deadline,
+ * which also abandons the walks under way. stop_reason() tells which.
+ *
+ * With use_verdicts(), candidates are first looked up in a verdict_cache
+ * shared by all walks, and those already found infrequent are not counted.
+ *
+ * With use_vat_cache(), the VATs of frequent candidates are kept in a
+ * vat_cache shared by all walks, so that a walk taking the same extensions
+ * as an earlier one reuses its VATs (concurrent_memory_storage only).
+ *
+ * With use_enumeration(), walks take their steps among the frequent
+ * extensions enumerated from the transaction graphs (see
+ * gen_enum_max_graph()) instead of trying random candidates.
+ *
+ * With keep_tids() on, the tid list of each new maximal pattern is kept
+ * along with its code (see samples()), for selecting representatives.
+ *
+ * With trace_walks(), a walk_record of every walk goes to a trace file.
+ */
+template <class CS, class SM, class L1MAP, class TRIPLES> class walk_engine {
+public:
+  typedef typename CS::PATTERN PATTERN;
+  typedef vector<pair<unsigned int, unsigned int>> STAT;
+  typedef vector<pair<code_key, vector<unsigned int>>> SAMPLES;
+  typedef typename CS::VAT_CACHE VAT_CACHE;
+  typedef trans_graphs<typename PATTERN::VERTEX_T, typename PATTERN::EDGE_T>
+      GRAPHS;
+
+  walk_engine(pat_fam<PATTERN> &level_one_pats, L1MAP &l1map,
+              const TRIPLES &triples, SM &vat_map, const int &minsup)
+      : _l1_pats(level_one_pats), _l1map(l1map), _triples(triples),
+        _vat_map(vat_map), _minsup(minsup), _stop_reason(stop_policy::NONE),
+        _walks(0), _ended(0), _last_new(0), _max_count(0), _failed(0),
+        _keep_tids(false), _verdicts(0), _vat_cache(0), _graphs(0), _trace(0) {}
+
+  ~walk_engine() {
+    delete _verdicts;
+    delete _vat_cache;
+  }
+
+  /** Remembers the verdicts of up to 2^log2_slots candidates across walks,
+   * with a Bloom filter in front if bloom is set; 0 turns this off */
+  void use_verdicts(const unsigned int &log2_slots, const bool &bloom) {
+    delete _verdicts;
+    _verdicts = log2_slots ? new verdict_cache(log2_slots, bloom) : 0;
+  }
+
+  const verdict_cache *verdicts() const { return _verdicts; }
+
+  /** Keeps up to budget_bytes of candidate VATs across walks; 0 turns this
+   * off */
+  void use_vat_cache(const unsigned long int &budget_bytes) {
+    delete _vat_cache;
+    _vat_cache = budget_bytes ? new VAT_CACHE(budget_bytes) : 0;
+  }
+
+  const VAT_CACHE *vat_cache() const { return _vat_cache; }
+
+  /** Walks enumerate their extensions from graphs, which must hold all
+   * transactions; 0 goes back to trying random candidates */
+  void use_enumeration(const GRAPHS *graphs) { _graphs = graphs; }
+
+  /** Records every walk in trace (see walk_record); 0 turns this off */
+  void trace_walks(walk_trace_writer *trace) { _trace = trace; }
+
+  /** Whether run() keeps the tid lists of the maximal patterns */
+  void keep_tids(const bool &keep) { _keep_tids = keep; }
+
+  /** Runs walks on num_threads threads until the stopping condition holds.
+   * Each new maximal pattern is printed to cout as soon as it is found. */
+  void run(const unsigned int &num_threads, const stop_policy &stop,
+           const unsigned int &seed) {
+    _stop = stop;
+    _stop.start();
+    _stop_reason = stop_policy::NONE;
+    unsigned int n = num_threads ? num_threads : 1;
+    _worker_stats.assign(n, STAT());
+    _worker_samples.assign(n, SAMPLES());
+
+    if (n == 1) {
+      worker(0, seed);
+    } else {
+      vector<thread> pool;
+      for (unsigned int t = 0; t < n; t++)
+        pool.push_back(thread(&walk_engine::worker, this, t, seed + t));
+      for (unsigned int t = 0; t < n; t++)
+        pool[t].join();
+    }
+
+    // merge the per-thread (duplicate, new) counts
+    _stat.clear();
+    for (unsigned int t = 0; t < n; t++) {
+      const STAT &ws = _worker_stats[t];
+      if (ws.size() > _stat.size())
+        _stat.resize(ws.size(), make_pair(0, 0));
+      for (unsigned int k = 0; k < ws.size(); k++) {
+        _stat[k].first += ws[k].first;
+        _stat[k].second += ws[k].second;
+      }
+    }
+
+    _samples.clear();
+    for (unsigned int t = 0; t < n; t++) {
+      _samples.insert(_samples.end(), _worker_samples[t].begin(),
+                      _worker_samples[t].end());
+      SAMPLES().swap(_worker_samples[t]);
+    }
+  }
+
+  const concurrent_pat_set<code_key, myhash<code_key>> &all_pat() const {
+    return _all_pat;
+  }
+
+  /** Number of (duplicate, new) maximal patterns, indexed by edge count - 1 */
+  const STAT &stat() const { return _stat; }
+
+  /** Code and tid list of every distinct maximal pattern, if kept */
+  const SAMPLES &samples() const { return _samples; }
+
+  /** The counts the stop_policy decides on, as of now */
+  stop_policy::sample sample() const {
+    stop_policy::sample s;
+    s.walks = _all_pat.occurrences();
+    s.idle = _ended - _last_new;
+    s.distinct = _max_count;
+    s.once = _all_pat.singletons();
+    s.twice = _all_pat.doubletons();
+    return s;
+  }
+
+  /** Why run() stopped */
+  stop_policy::reason stop_reason() const {
+    return (stop_policy::reason)_stop_reason.load();
+  }
+
+  unsigned long walks() const { return _walks; }
+  int max_count() const { return _max_count; }
+  long failed() const { return _failed; }
+
+private:
+  // the first reason to stop is kept
+  bool done() {
+    stop_policy::reason r = _stop.check(sample());
+    if (r == stop_policy::NONE)
+      return false;
+    int none = stop_policy::NONE;
+    _stop_reason.compare_exchange_strong(none, r);
+    return true;
+  }
+
+  void worker(unsigned int id, unsigned int seed) {
+    seed_randint(seed);
+    CS cs(_vat_map);
+    cs.set_cache(_vat_cache);
+    STAT &stat = _worker_stats[id];
+    long failed = 0;
+
+    while (!done()) {
+      // the patterns of a walk all die with it, see WALK_ALLOC
+      walk_scope scope;
+      unsigned long walk_no = ++_walks;
+      int index = randint(0, _l1_pats.size());
+      PATTERN *pat = _l1_pats[index]->exact_clone();
+
+      long prev_failed = failed;
+      walk_shape shape;
+      walk_shape *traced = _trace ? &shape : 0;
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      bool ended =
+          _graphs ? gen_enum_max_graph(pat, *_graphs, _minsup, cs, _all_pat,
+                                       stat, failed, traced, &_stop)
+                  : gen_random_max_graph(pat, _l1map, _minsup, cs, _triples,
+                                         _all_pat, stat, failed, _verdicts,
+                                         traced, &_stop);
+      if (!ended) { // abandoned at the deadline, pat is not maximal
+        if (pat->size() > 2)
+          cs.delete_vat(pat);
+        delete pat;
+        continue;
+      }
+      unsigned long end_no = ++_ended;
+      if (_trace)
+        _trace->add(walk_trace_record(walk_no, id, index, start, shape, pat,
+                                      failed != prev_failed));
+
+      if (failed == prev_failed) { // a new maximal pattern
+        _max_count++;
+        unsigned long last = _last_new;
+        while (last < end_no &&
+               !_last_new.compare_exchange_weak(last, end_no))
+          ;
+        if (_keep_tids) {
+          _worker_samples[id].push_back(
+              make_pair(check_isomorphism(pat).key(), vector<unsigned int>()));
+          cs.get_vat(pat)->get_tids(_worker_samples[id].back().second);
+        }
+        std::lock_guard<std::mutex> guard(_out_lock);
+        cout << pat << endl;
+      }
+
+      // level-one VATs are shared, everything bigger belongs to this walk
+      if (pat->size() > 2)
+        cs.delete_vat(pat);
+      delete pat;
+    }
+    _failed += failed;
+  }
+
+  static walk_record
+  walk_trace_record(const unsigned long &walk_no, const unsigned int &id,
+                    const int &start_index,
+                    const std::chrono::steady_clock::time_point &start,
+                    const walk_shape &shape, const PATTERN *pat,
+                    const bool &duplicate) {
+    walk_record r;
+    memset(&r, 0, sizeof(r));
+    r.walk = walk_no;
+    r.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    r.peak_vat_bytes = shape.peak_vat_bytes;
+    r.start = start_index;
+    r.steps = shape.steps;
+    r.failed = shape.failed;
+    r.edges = pat->get_edge_count();
+    r.vertices = pat->size();
+    r.thread = id;
+    r.duplicate = duplicate;
+    return r;
+  }
+
+  pat_fam<PATTERN> &_l1_pats;
+  L1MAP &_l1map;
+  const TRIPLES &_triples;
+  SM &_vat_map;
+  int _minsup;
+  stop_policy _stop;
+  atomic<int> _stop_reason; // a stop_policy::reason
+
+  concurrent_pat_set<code_key, myhash<code_key>> _all_pat;
+  atomic<unsigned long> _walks;    // walks started so far
+  atomic<unsigned long> _ended;    // walks ended at a maximal pattern
+  atomic<unsigned long> _last_new; // _ended after the last walk with a new pat
+  atomic<int> _max_count;
+  atomic<long> _failed;
+  vector<STAT> _worker_stats;
+  STAT _stat;
+  bool _keep_tids;
+  verdict_cache *_verdicts;
+  VAT_CACHE *_vat_cache;
+  const GRAPHS *_graphs;
+  walk_trace_writer *_trace;
+  vector<SAMPLES> _worker_samples;
+  SAMPLES _samples;
+  std::mutex _out_lock;
+
+}; // end class walk_engine
+
+#endif
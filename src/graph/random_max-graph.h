@@ -19,20 +19,35 @@
 #ifndef _GRAPH_MAX_GEN_H
 #define _GRAPH_MAX_GEN_H
 
+#include "concurrent_pat_set.h"
+#include "edge_triples.h"
+#include "graph_extensions.h"
 #include "graph_iso_check.h"
 #include "helper_funs.h"
 #include "level_one_hmap.h"
+#include "metrics.h"
+#include "stop_policy.h"
 #include "typedefs.h"
+#include "verdict_cache.h"
+#include "walk_trace.h"
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
+#include <random>
 #include <string>
 
 extern unsigned long int freq_pats_count;
 extern bool print;
 typedef unsigned int uint;
 
+// every walker thread draws from its own generator, see seed_randint()
+thread_local std::mt19937 walk_rng;
+
+// (re)seed the random generator of the calling thread
+void seed_randint(unsigned int seed) { walk_rng.seed(seed); }
+
 // return a random number between lowest(including) and highest(excluding)
 uint randint(int lowest, int highest) {
   if (highest < lowest) {
@@ -41,145 +56,147 @@ uint randint(int lowest, int highest) {
   }
   uint random_integer;
   int range = (highest - lowest);
-  random_integer = lowest + rand() % range;
+  random_integer = lowest + walk_rng() % range;
   return random_integer;
 }
 
-template <typename V_T, typename E_T> struct failed_map {
-  typedef set<E_T> EDG_L;
-  typedef typename set<E_T>::iterator EIT;
-  typedef typename EDG_L::const_iterator CEIT;
-  typedef map<V_T, EDG_L> INSIDE_MAP;
-  typedef typename map<V_T, EDG_L>::iterator MIT;
-  typedef typename map<V_T, EDG_L>::const_iterator CMIT;
-  typedef map<int, INSIDE_MAP> OUTSIDE_MAP;
-  typedef typename OUTSIDE_MAP::iterator IT;
-  typedef typename OUTSIDE_MAP::const_iterator CIT;
-  OUTSIDE_MAP _fm;
+// records a finished walk's min-dfs code; returns true if it was not seen
+// before
+inline bool record_max_pat(map<std::string, int> &all_pat,
+                           const std::string &min_dfs_cc) {
+  map<std::string, int>::iterator x = all_pat.find(min_dfs_cc);
+  if (x == all_pat.end()) {
+    all_pat.insert(make_pair(min_dfs_cc, 1));
+    return true;
+  }
+  x->second++;
+  return false;
+}
+
+inline bool record_max_pat(concurrent_pat_set<std::string> &all_pat,
+                           const std::string &min_dfs_cc) {
+  return all_pat.insert(min_dfs_cc) == 1;
+}
+
+inline bool record_max_pat(map<code_key, int> &all_pat,
+                           const code_key &min_dfs_cc) {
+  return ++all_pat[min_dfs_cc] == 1;
+}
+
+inline bool
+record_max_pat(concurrent_pat_set<code_key, myhash<code_key>> &all_pat,
+               const code_key &min_dfs_cc) {
+  return all_pat.insert(min_dfs_cc) == 1;
+}
+
+// keeps the size of vat, the VAT of a walk's pattern, if it is the largest
+template <class VAT> void note_vat_bytes(walk_shape &shape, const VAT *vat) {
+  if (vat && vat->byte_size() > shape.peak_vat_bytes)
+    shape.peak_vat_bytes = vat->byte_size();
+}
+
+// records the end of a walk at the maximal pattern pat in all_pat and stat;
+// returns true if no walk ended at pat before, else counts a failure
+template <typename PAT, class ALL_PAT>
+bool record_walk_end(PAT *pat, ALL_PAT &all_pat,
+                     vector<pair<unsigned int, unsigned int>> &stat,
+                     long &failed) {
+  const typename PAT::CAN_CODE &cc = check_isomorphism(pat);
+  code_key min_dfs_cc = cc.key();
+
+  unsigned int pat_size = (pat->canonical_code()).size();
+  if (pat_size > stat.size()) {
+    stat.resize(pat_size, make_pair(0, 0));
+  }
+  if (record_max_pat(all_pat, min_dfs_cc)) {
+    stat[pat_size - 1].second++;
+    return true;
+  }
+  failed++;
+  stat[pat_size - 1].first++;
+  return false;
+}
+
+// edges a walk failed to extend its pattern with, from each vertex of the
+// pattern: one bitset of edge triple ids (see edge_triples) per vertex
+struct failed_map {
+  explicit failed_map(const unsigned int &num_triples)
+      : _words((num_triples + 63) / 64) {}
 
   void print() const {
-    CIT cit = _fm.begin();
-    for (; cit != _fm.end(); cit++) {
-      cout << cit->first << ":\n";
-      const INSIDE_MAP &im = cit->second;
-      CMIT cmit = im.begin();
-      for (; cmit != im.end(); cmit++) {
-        cout << "(" << cmit->first << "==> ";
-        CEIT ceit = cmit->second.begin();
-        for (; ceit != cmit->second.end(); ceit++)
-          cout << *ceit << " ";
-        cout << ")\n";
-      }
+    for (unsigned int vid = 0; (vid + 1) * _words <= _bits.size(); vid++) {
+      cout << vid << ":";
+      for (unsigned int t = 0; t < 64 * _words; t++)
+        if (exist(vid, t))
+          cout << " " << t;
+      cout << "\n";
     }
   }
 
-  void insert(int vid, V_T v_l, E_T e_l) {
-    IT it;
-    it = _fm.find(vid);
-    if (it == _fm.end()) {
-      EDG_L e_set;
-      e_set.insert(e_l);
-      INSIDE_MAP im;
-      im.insert(make_pair(v_l, e_set));
-      _fm.insert(make_pair(vid, im));
-      return;
-    } else {
-      INSIDE_MAP &im = it->second;
-      MIT mit = im.find(v_l);
-      if (mit == im.end()) {
-        EDG_L e_set;
-        e_set.insert(e_l);
-        im.insert(make_pair(v_l, e_set));
-      } else {
-        EDG_L &edge_set = mit->second;
-        pair<EIT, bool> ret = edge_set.insert(e_l);
-        if (ret.second == false) {
-          cout << "ERROR in failed_map:insert, this edge already present!\n";
-          exit(1);
-        }
-      }
+  void insert(const int &vid, const int &edge_id) {
+    if ((vid + 1) * _words > _bits.size())
+      _bits.resize((vid + 1) * _words, 0);
+    uint64_t &w = _bits[vid * _words + edge_id / 64];
+    uint64_t bit = (uint64_t)1 << (edge_id % 64);
+    if (w & bit) {
+      cout << "ERROR in failed_map:insert, this edge already present!\n";
+      exit(1);
     }
+    w |= bit;
   }
 
-  bool exist(int vid, V_T v_l, E_T e_l) const {
-    CIT it;
-    it = _fm.find(vid);
-    if (it == _fm.end())
-      return false;
-    else {
-      const INSIDE_MAP &im = it->second;
-      CMIT mit = im.find(v_l);
-      if (mit == im.end())
-        return false;
-      else {
-        const EDG_L &edge_set = mit->second;
-        CEIT eit = edge_set.find(e_l);
-        if (eit == edge_set.end())
-          return false;
-        else
-          return true;
-      }
-    }
+  bool exist(const int &vid, const int &edge_id) const {
+    size_t k = vid * _words + edge_id / 64;
+    return k < _bits.size() && ((_bits[k] >> (edge_id % 64)) & 1);
   }
-};
 
-template <typename V_T, typename E_T> struct edge_counter {
-  typedef pair<pair<V_T, V_T>, E_T> EDGE_T;
-  typedef typename map<EDGE_T, unsigned int>::iterator IT;
-  typedef typename map<EDGE_T, unsigned int>::const_iterator CIT;
+  unsigned int _words;    // per vertex
+  vector<uint64_t> _bits; // vertex by vertex
+};
 
-  map<EDGE_T, unsigned int> _counter;
+// number of edges of each edge triple id in a walk's pattern
+struct edge_counter {
+  explicit edge_counter(const unsigned int &num_triples)
+      : _counter(num_triples, 0) {}
 
-  uint get_count(V_T src_l, V_T dest_l, E_T edge_l) {
-    EDGE_T e;
-    if (src_l < dest_l)
-      e = make_pair(make_pair(src_l, dest_l), edge_l);
-    else
-      e = make_pair(make_pair(dest_l, src_l), edge_l);
-    CIT cit = _counter.find(e);
-    if (cit != _counter.end())
-      return cit->second;
-    else
-      return 0;
-  }
-  void insert(V_T src_l, V_T dest_l, E_T edge_l) {
-    EDGE_T e;
-    if (src_l < dest_l)
-      e = make_pair(make_pair(src_l, dest_l), edge_l);
-    else
-      e = make_pair(make_pair(dest_l, src_l), edge_l);
-    IT it = _counter.find(e);
-    if (it == _counter.end())
-      _counter.insert(make_pair(e, 1));
-    else
-      it->second++;
+  unsigned int get_count(const int &edge_id) const {
+    return _counter[edge_id];
   }
-  void print() const {
-    CIT cit = _counter.begin();
-    for (; cit != _counter.end(); cit++)
+  void insert(const int &edge_id) { _counter[edge_id]++; }
 
-      cout << "(" << cit->first.first.first << " " << cit->first.second << " "
-           << cit->first.first.second << "):" << cit->second << endl;
-  }
+  vector<unsigned int> _counter;
+};
 
-  bool operator<(const edge_counter &other) const {
-    const map<EDGE_T, unsigned int> &other_cnt = other._counter;
-    return (_counter < other_cnt);
+// id of the edge labelled e between labels a and b, which must be one of the
+// frequent single edges
+template <class TRIPLES, typename V_T, typename E_T>
+int walk_edge_id(const TRIPLES &triples, const V_T &a, const V_T &b,
+                 const E_T &e) {
+  int id = triples.id(a, b, e);
+  if (id < 0) {
+    cout << "In gen_random_max_graph: edge (" << a << " " << e << " " << b
+         << ") is not a frequent edge\n";
+    exit(1);
   }
-};
+  return id;
+}
 
+// Random walk from pat to a maximal pattern, which is recorded in all_pat
+// and stat. Returns false, with the walk abandoned and nothing recorded, if
+// the deadline of stop passes before the walk ends.
 template <typename PP, class MP, class PAT_ST,
           template <class, typename, typename> class CC, class EDGE_MAP,
-          class SM_TYPE>
-void gen_random_max_graph(
+          class SM_TYPE, template <typename, typename> class VAT_ST,
+          class ALL_PAT>
+bool gen_random_max_graph(
     GRAPH_PATTERN *&pat, EDGE_MAP &emap, const int &minsup,
-    count_support<GRAPH_PROP, V_Fk1_MINE_PROP, PAT_ST, CC, SM_TYPE> &cs,
-    map<pair<pair<typename GRAPH_PATTERN::VERTEX_T,
-                  typename GRAPH_PATTERN::VERTEX_T>,
-             typename GRAPH_PATTERN::EDGE_T>,
-        int> &edge_freq,
-    map<std::string, int> &all_pat,
-    vector<pair<unsigned int, unsigned int>> &stat, long &failed) {
+    count_support<GRAPH_PROP, V_Fk1_MINE_PROP, PAT_ST, CC, SM_TYPE, VAT_ST>
+        &cs,
+    const edge_triples<typename GRAPH_PATTERN::VERTEX_T,
+                       typename GRAPH_PATTERN::EDGE_T> &triples,
+    ALL_PAT &all_pat, vector<pair<unsigned int, unsigned int>> &stat,
+    long &failed, verdict_cache *verdicts = 0, walk_shape *shape = 0,
+    const stop_policy *stop = 0) {
 #ifdef PRINT
   cout << "In call to gen_random_max_graph" << endl;
 #endif
@@ -189,38 +206,35 @@ void gen_random_max_graph(
   GRAPH_PATTERN *edge = 0;
   GRAPH_PATTERN *cand_pat = 0;
 
-  typename EDGE_MAP::CONST_NIT nit; // neighbor's iterator
-  typename EDGE_MAP::CONST_LIT lit; // edge label iterator
   typedef typename GRAPH_PATTERN::VERTEX_T V_T;
   typedef typename GRAPH_PATTERN::EDGE_T E_T;
-  typedef pair<pair<V_T, V_T>, E_T> ONE_EDGE;
-  typedef map<ONE_EDGE, int> EDGE_FREQ;
-  typedef typename EDGE_FREQ::const_iterator F_CIT;
-  // typedef map<edge_counter<typename GRAPH_PATTERN::VERTEX_T, typename
-  // GRAPH_PATTERN::VERTEX_T>, int > ALL_PAT;
-  typedef map<std::string, int> ALL_PAT;
-  typedef typename ALL_PAT::iterator APIT;
-  failed_map<V_T, E_T> fm;
-  set<int> expired_vids;
-
-  ONE_EDGE this_edge;
+  failed_map fm(triples.size());
+  vector<char> expired; // by vertex id
+  unsigned int num_expired = 0;
+
+  int this_edge; // id of the edge triple tried
 
   // get a random extention for this candidate pattern, which is frequent
   // srand((unsigned)time(0)); // initializing random-seed
 
   bool extended = false;
-  edge_counter<V_T, E_T> edge_counter;
+  edge_counter edge_counter(triples.size());
+  vector<int> dest_vids; // of the step, kept so steps reuse its storage
 
   E_T e;
   pat->get_out_edge(0, 1, e);
-  edge_counter.insert(pat->label(0), pat->label(1), e);
+  edge_counter.insert(walk_edge_id(triples, pat->label(0), pat->label(1), e));
+  if (shape)
+    note_vat_bytes(*shape, cs.get_vat(pat));
 
   while (true) {
+    if (stop && stop->past_deadline())
+      return false;
     uint current_size = pat->size();
-    assert(current_size != expired_vids.size());
+    expired.resize(current_size, 0);
+    assert(current_size != num_expired);
     int vid = randint(0, current_size);
-    while (expired_vids.find(vid) !=
-           expired_vids.end()) { // this vertex expired
+    while (expired[vid]) { // this vertex expired
       vid = (vid + 1) % current_size;
     }
 
@@ -230,57 +244,42 @@ void gen_random_max_graph(
 
 #ifdef PRINT
     cout << "The following vertex expired:";
-    for (set<int>::iterator st = expired_vids.begin(); st != expired_vids.end();
-         st++) {
-      cout << *st << " ";
-    }
+    for (uint st = 0; st < current_size; st++)
+      if (expired[st])
+        cout << st << " ";
     cout << endl;
     cout << "Randomly selected vertex-id:" << vid << " with label:" << src_v
          << endl;
 #endif
 
-    const typename EDGE_MAP::NEIGHBORS &nbrs = emap.get_neighbors(src_v);
+    // the edges at src_v, one contiguous array
+    const typename EDGE_MAP::EDGE *nbrs = emap.get_edges(src_v);
+    int neighbor_count = emap.get_neighbors_count(src_v);
 
 #ifdef PRINT
-    nit = nbrs.begin();
-    while (nit != nbrs.end()) {
-      cout << "dest = " << nit->first
-           << ", second.size = " << nit->second.size() << "===>";
-      for (lit = nit->second.begin(); lit != nit->second.end(); lit++)
-        cout << *lit << " ";
-      cout << endl;
-      nit++;
-    }
+    for (int k = 0; k < neighbor_count; k++)
+      cout << "dest = " << nbrs[k].dest << ", label = " << nbrs[k].e_lbl
+           << endl;
 #endif
 
-    int neighbor_count = emap.get_neighbors_count(src_v);
     uint eid = randint(0, neighbor_count);
     uint end_id = eid;
     bool elig = false;
     V_T dest_v;
+    E_T e_lbl;
     do {
-      nit = nbrs.begin();
-
 #ifdef PRINT
       cout << "Current attmpt of edge:" << eid << endl;
 #endif
-      uint tmp_eid = eid;
-      while (tmp_eid > nit->second.size() - 1) {
-        tmp_eid = tmp_eid - nit->second.size();
-        nit++;
-      }
-
-      lit = nit->second.begin();
-      while (tmp_eid > 0) {
-        lit++;
-        tmp_eid--;
-      }
-      dest_v = nit->first;
+      dest_v = nbrs[eid].dest;
+      e_lbl = nbrs[eid].e_lbl;
 #ifdef PRINT
       cout << "Destination choice of edge from random choice:";
-      cout << "Src:" << src_v << " Dest:" << dest_v << " Edge label:" << *lit;
+      cout << "Src:" << src_v << " Dest:" << dest_v << " Edge label:" << e_lbl;
 #endif
-      if (fm.exist(vid, dest_v, *lit)) {
+      this_edge = nbrs[eid].id;
+      if (fm.exist(vid, this_edge)) {
+        metrics::add(metrics::FAILED_MAP_HIT);
 #ifdef PRINT
         cout << "already in failed-map! Failed\n";
 #endif
@@ -288,56 +287,29 @@ void gen_random_max_graph(
         continue;
       }
 
-      if (src_v < dest_v)
-        this_edge = make_pair(make_pair(src_v, dest_v), *lit);
-      else
-        this_edge = make_pair(make_pair(dest_v, src_v), *lit);
-
-      int frequency = edge_counter.get_count(src_v, dest_v, *lit);
-      F_CIT f_cit = edge_freq.find(this_edge);
-      if (f_cit == edge_freq.end()) {
-        if (frequency == 0) {
-          elig = true;
-          break;
-        } // this is an eligible edge
-      } else {
-        if (frequency < f_cit->second) {
-          elig = true;
-          break;
-        }
-      }
+      // an edge may occur in the pattern as often as in one transaction
+      int frequency = edge_counter.get_count(this_edge);
+      if (frequency < triples.limit(this_edge)) {
+        elig = true;
+        break;
+      } // this is an eligible edge
 #ifdef PRINT
       cout << " failed! This edge already in graph, inserting in failed-map\n";
 #endif
-      fm.insert(vid, dest_v, *lit);
+      fm.insert(vid, this_edge);
       eid = (eid + 1) % neighbor_count;
     } while (eid != end_id);
 
     if (elig == false) { // no edge was found to extend from this source v-id
-      expired_vids.insert(vid);
-      if (expired_vids.size() == (unsigned)pat->size()) {
-
-        const typename GRAPH_PATTERN::CAN_CODE &cc = check_isomorphism(pat);
-        std::string min_dfs_cc = cc.to_string();
-        APIT x = all_pat.find(min_dfs_cc);
-
-        int pat_size = (pat->canonical_code()).size();
-        if (pat_size > stat.size()) {
-          stat.resize(pat_size, make_pair(0, 0));
-        }
-        if (x == all_pat.end()) {
-          all_pat.insert(make_pair(min_dfs_cc, 1));
-          stat[pat_size - 1].second++;
+      expired[vid] = 1;
+      if (++num_expired == (unsigned)pat->size()) {
+        if (record_walk_end(pat, all_pat, stat, failed)) {
 #ifdef PRINT
           cout << "This is a max sub-graph:\n";
           cout << pat << endl;
           cout << "VAT for the max graph: " << cs.get_vat(pat) << endl;
           cout << "Pattern size = " << (pat->canonical_code()).size() << endl;
 #endif
-        } else {
-          failed++;
-          x->second++;
-          stat[pat_size - 1].first++;
         }
         break; // this is the break from where the outside infinite loop breaks.
       }
@@ -346,7 +318,6 @@ void gen_random_max_graph(
 
     // first creating all one-edge pattern
     edge = new GRAPH_PATTERN;
-    E_T e_lbl(*lit);
 
     if (src_v < dest_v)
       make_edge(edge, src_v, dest_v, e_lbl);
@@ -354,89 +325,102 @@ void gen_random_max_graph(
       make_edge(edge, dest_v, src_v, e_lbl);
 
     // trying all the possible back-edges and forward-edge extension
-    vector<int> *dest_vids = pat->get_vids_for_this_label(dest_v);
-    vector<int>::iterator vit = dest_vids->begin();
-    while (vit < dest_vids->end()) {
+    pat->get_vids_for_this_label(dest_v, dest_vids);
+    vector<int>::iterator vit = dest_vids.begin();
+    while (vit < dest_vids.end()) {
       if (*vit == vid || pat->get_out_edge(vid, *vit, e))
-        dest_vids->erase(vit);
+        dest_vids.erase(vit);
       else
         vit++;
     }
-    dest_vids->push_back(pat->size());
+    dest_vids.push_back(pat->size());
 
 #ifdef PRINT
     cout << "choices for dest_vid:";
-    for (uint i = 0; i < dest_vids->size(); i++) {
-      cout << (*dest_vids)[i] << " ";
+    for (uint i = 0; i < dest_vids.size(); i++) {
+      cout << dest_vids[i] << " ";
     }
     cout << "\n";
 #endif
 
-    extended = false;
-    for (vector<int>::iterator it = dest_vids->begin(); it < dest_vids->end();
-         it++) {
-      cand_pat = pat->clone();
-      uint lvid = 0;
-      bool isfwd = false;
-      if (it == dest_vids->end() - 1) { // this is the forward extention case
-        lvid = cand_pat->add_vertex(dest_v);
-        assert(lvid == pat->size());
-        isfwd = true;
-      } else {
-        lvid = *it;
+    // all candidates for this edge are counted in one pass over pat's VAT;
+    // the first frequent one, back edges before the forward edge, is taken
+    int num_cands = dest_vids.size();
+    vector<GRAPH_PATTERN *> cands(num_cands, (GRAPH_PATTERN *)0);
+    vector<code_key> cand_keys(num_cands);
+    vector<verdict_cache::verdict> known(num_cands, verdict_cache::UNKNOWN);
+    int num_live = 0; // candidates to count, not known to be infrequent
+    // candidates share pat's graph and code until one is taken (see
+    // pattern::extension()); the last one is the forward extension
+    for (int c = 0; c < num_cands; c++) {
+      typename GRAPH_PATTERN::CAN_CODE::FIVE_TUPLE new_tuple(
+          vid, dest_vids[c], src_v, e_lbl, dest_v);
+      cand_pat = pat->extension(new_tuple);
+
+      // a candidate found infrequent before, in any walk, is not counted.
+      // The key is the candidate's own code, not its minimum DFS code: the
+      // VAT, and so the support, depends on the order the edges were added
+      // in, as embeddings with equal edge sets are kept only once.
+      if (verdicts) {
+        cand_keys[c] = cand_pat->key();
+        known[c] = verdicts->find(cand_keys[c].fp);
+        metrics::add(known[c] == verdict_cache::UNKNOWN
+                         ? metrics::VERDICT_MISS
+                         : metrics::VERDICT_HIT);
+        if (known[c] == verdict_cache::INFREQUENT) {
+          delete cand_pat;
+          continue;
+        }
       }
+      cands[c] = cand_pat;
+      num_live++;
+      // only the first frequent candidate is taken, so the ones after a
+      // candidate known to be frequent are not even counted
+      if (known[c] == verdict_cache::FREQUENT)
+        break;
+    }
 
-      cand_pat->add_out_edge(vid, *it, *lit);
-      cand_pat->add_out_edge(*it, vid, *lit);
-      typename GRAPH_PATTERN::CAN_CODE::FIVE_TUPLE new_tuple(vid, lvid, src_v,
-                                                             *lit, dest_v);
-      typename GRAPH_PATTERN::CAN_CODE &cur_code = cand_pat->canonical_code();
-      cur_code.push_back(new_tuple);
+    // when all are known to be infrequent, the edge fails at no cost
+    if (num_live) {
+      cs.count_batch(pat, edge, cands.data(), minsup, num_cands, vid,
+                     dest_vids.data());
+      if (shape)
+        shape->steps++;
+    }
+    delete edge;
+    edge = 0;
 
-      // cout << "Calling count()" << endl;
-      cs.count(pat, edge, &cand_pat, minsup, 1, isfwd, make_pair(vid, *it));
+    extended = false;
+    for (int c = 0; c < num_cands; c++) {
+      if (!cands[c])
+        continue;
+      bool frequent = cands[c]->is_valid(minsup);
+      if (verdicts && known[c] == verdict_cache::UNKNOWN)
+        verdicts->insert(cand_keys[c].fp, frequent);
 #ifdef PRINT
-      cout << cand_pat << endl;
+      cout << GRAPH_PATTERN::CAN_CODE::to_string(cands[c]->key()) << endl;
 #endif
-      if (cand_pat->is_valid(minsup)) { // is the pattern frequent?
-        // cout << "Found frequent graph of size = " << cand_pat->size() <<
-        // endl; cout << cand_pat << endl;
+      if (frequent && !extended) { // is the pattern frequent?
+        cands[c]->materialize();
         delete pat;
-        pat = cand_pat;
-        // cout << "freq pattern, size:" << pat->size() << endl;
-        edge_counter.insert(src_v, dest_v, *lit);
-        /***
-                if (pat->size() >= 2) {
-                  //std::string min_dfs_cc = cur_code.to_string();
-                  const typename GRAPH_PATTERN::CAN_CODE& cc =
-        check_isomorphism(pat); std::string min_dfs_cc = cc.to_string(); APIT x
-        = all_pat.find(min_dfs_cc); if (x == all_pat.end()) {
-                    // all_pat.insert(make_pair(edge_counter, 1));
-                    all_pat.insert(make_pair(min_dfs_cc, 1));
-                  }
-                  else {
-                    failed++;
-                    x->second++;
-                  }
-                  success++;
-                }
-        ***/
-        delete edge;
-        edge = 0;
-        delete dest_vids;
+        pat = cands[c];
+        edge_counter.insert(this_edge);
         extended = true;
-        break;
+        if (shape)
+          note_vat_bytes(*shape, cs.get_vat(pat));
       } else {
-        delete cand_pat;
+        if (frequent) // not taken, its VAT is not needed
+          cs.delete_vat(cands[c]);
+        delete cands[c];
       }
     }
     if (extended == true)
       continue;
     // extended is not true, all the extention tried, so this edge
     // is failed edge
-    delete edge;
-    delete dest_vids;
-    fm.insert(vid, dest_v, *lit);
+    fm.insert(vid, this_edge);
+    if (shape)
+      shape->failed++;
 
     // cout << "Leaving random_max_graph" << endl;
 #ifdef PRINT
@@ -445,8 +429,76 @@ void gen_random_max_graph(
     cout << endl;
 #endif
   }
+  return true;
 } // end random_max_graph
 
+/**
+ * Random walk to a maximal pattern like gen_random_max_graph(), but each step
+ * first enumerates the frequent extensions of pat from its embeddings in the
+ * transaction graphs (see frequent_extensions()) and takes one of them,
+ * uniformly at random. Only the extension taken is counted, and it is always
+ * frequent; pat is maximal once it has no frequent extension. Returns false
+ * if the walk was abandoned at the deadline of stop.
+ */
+template <typename PP, class MP, class PAT_ST,
+          template <class, typename, typename> class CC, class SM_TYPE,
+          template <typename, typename> class VAT_ST, class ALL_PAT>
+bool gen_enum_max_graph(
+    GRAPH_PATTERN *&pat,
+    const trans_graphs<typename GRAPH_PATTERN::VERTEX_T,
+                       typename GRAPH_PATTERN::EDGE_T> &graphs,
+    const int &minsup,
+    count_support<GRAPH_PROP, V_Fk1_MINE_PROP, PAT_ST, CC, SM_TYPE, VAT_ST>
+        &cs,
+    ALL_PAT &all_pat, vector<pair<unsigned int, unsigned int>> &stat,
+    long &failed, walk_shape *shape = 0, const stop_policy *stop = 0) {
+  typedef typename GRAPH_PATTERN::VERTEX_T V_T;
+  typedef typename GRAPH_PATTERN::EDGE_T E_T;
+  vector<graph_extension<V_T, E_T>> exts;
+
+  while (true) {
+    if (stop && stop->past_deadline())
+      return false;
+    if (shape)
+      note_vat_bytes(*shape, cs.get_vat(pat));
+    frequent_extensions(pat, cs.get_vat(pat), graphs, minsup, exts);
+    if (exts.empty()) {
+      record_walk_end(pat, all_pat, stat, failed);
+      break;
+    }
+
+    const graph_extension<V_T, E_T> &x = exts[randint(0, exts.size())];
+    const V_T &src_v = pat->label(x.src);
+    GRAPH_PATTERN *edge = new GRAPH_PATTERN;
+    if (src_v < x.dest_lbl)
+      make_edge(edge, src_v, x.dest_lbl, x.e_lbl);
+    else
+      make_edge(edge, x.dest_lbl, src_v, x.e_lbl);
+
+    GRAPH_PATTERN *cand_pat = pat->clone();
+    int lvid = x.is_fwd() ? cand_pat->add_vertex(x.dest_lbl) : x.dest;
+    cand_pat->add_out_edge(x.src, lvid, x.e_lbl);
+    cand_pat->add_out_edge(lvid, x.src, x.e_lbl);
+    cand_pat->canonical_code().push_back(
+        typename GRAPH_PATTERN::CAN_CODE::FIVE_TUPLE(x.src, lvid, src_v,
+                                                     x.e_lbl, x.dest_lbl));
+
+    cs.count(pat, edge, &cand_pat, minsup, 1, x.is_fwd(),
+             make_pair(x.src, lvid));
+    if (shape)
+      shape->steps++;
+    delete edge;
+    if (!cand_pat->is_valid(minsup)) {
+      cout << "In gen_enum_max_graph: an enumerated extension is not "
+              "frequent\n";
+      exit(1);
+    }
+    delete pat;
+    pat = cand_pat;
+  }
+  return true;
+} // end gen_enum_max_graph
+
 /** Populates p with a single-edged pattern;
     v1 is first vertex, v2 is second;
     It also populates p's canonical code */
@@ -0,0 +1,186 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file trans_graphs.h - the transaction graphs of the database, kept in
+ * memory as one CSR adjacency */
+#ifndef _TRANS_GRAPHS_H
+#define _TRANS_GRAPHS_H
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * \brief All transaction graphs of a database, in compressed sparse row
+ * form, for scanning the neighbourhoods of embeddings.
+ *
+ * The vertices of all transactions are numbered one after the other. The
+ * vertices of a transaction are in increasing order of their input vertex
+ * ids, which are the ids VATs store, so vertex() finds one by its vid with a
+ * direct look-up when the vids are dense, and a binary search when not.
+ * The neighbours of vertex v, with the labels of the edges leading to them,
+ * are the entries adj_begin(v) to adj_end(v) of the adjacency.
+ *
+ * Filled in by the graph tokenizer (see keep_trans()) and only read once
+ * the database is loaded.
+ */
+template <typename V_T, typename E_T> class trans_graphs {
+public:
+  typedef vector<pair<pair<int, int>, E_T>> EDGES;
+
+  trans_graphs() : _row_ptr(1, 0) {}
+
+  /**
+   * Adds transaction tid, with the labels of its vertices by input vertex id
+   * and its edges as (vid, vid) pairs with their label.
+   */
+  void add_trans(const int &tid, const map<int, V_T> &vlbls,
+                 const EDGES &edges) {
+    unsigned int first = _vids.size();
+    set_trans(tid, _trans.size());
+    trans t;
+    t.first = first;
+    t.nv = vlbls.size();
+    _trans.push_back(t);
+
+    for (typename map<int, V_T>::const_iterator it = vlbls.begin();
+         it != vlbls.end(); it++) {
+      _vids.push_back(it->first);
+      _vlbls.push_back(it->second);
+    }
+
+    // count the degrees, then place the neighbours
+    vector<unsigned int> fill(t.nv + 1, 0);
+    vector<pair<int, int>> ends(edges.size());
+    for (unsigned int e = 0; e < edges.size(); e++) {
+      ends[e].first = vertex(tid, edges[e].first.first);
+      ends[e].second = vertex(tid, edges[e].first.second);
+      if (ends[e].first < 0 || ends[e].second < 0)
+        continue; // the tokenizer reports edges to unknown vertices
+      fill[ends[e].first - first + 1]++;
+      fill[ends[e].second - first + 1]++;
+    }
+    unsigned int adj_off = _adj.size();
+    for (unsigned int v = 0; v < t.nv; v++) {
+      fill[v + 1] += fill[v];
+      _row_ptr.push_back(adj_off + fill[v + 1]);
+    }
+    _adj.resize(adj_off + fill[t.nv]);
+    _elbls.resize(adj_off + fill[t.nv]);
+    for (unsigned int e = 0; e < edges.size(); e++) {
+      int a = ends[e].first, b = ends[e].second;
+      if (a < 0 || b < 0)
+        continue;
+      unsigned int ka = adj_off + fill[a - first]++;
+      _adj[ka] = b;
+      _elbls[ka] = edges[e].second;
+      unsigned int kb = adj_off + fill[b - first]++;
+      _adj[kb] = a;
+      _elbls[kb] = edges[e].second;
+    }
+  }
+
+  /** Moves the transactions of other, none of which may be here yet, to the
+   * end of this database */
+  void append(trans_graphs &other) {
+    unsigned int v_shift = _vids.size(), a_shift = _adj.size();
+    for (unsigned int i = 0; i < other._trans.size(); i++) {
+      trans t = other._trans[i];
+      t.first += v_shift;
+      _trans.push_back(t);
+    }
+    for (unsigned int tid = 0; tid < other._by_tid.size(); tid++)
+      if (other._by_tid[tid] >= 0)
+        set_trans(tid, other._by_tid[tid] + _trans.size() -
+                           other._trans.size());
+
+    _vids.insert(_vids.end(), other._vids.begin(), other._vids.end());
+    _vlbls.insert(_vlbls.end(), other._vlbls.begin(), other._vlbls.end());
+    for (unsigned int v = 1; v < other._row_ptr.size(); v++)
+      _row_ptr.push_back(other._row_ptr[v] + a_shift);
+    for (unsigned int k = 0; k < other._adj.size(); k++)
+      _adj.push_back(other._adj[k] + v_shift);
+    _elbls.insert(_elbls.end(), other._elbls.begin(), other._elbls.end());
+
+    trans_graphs().swap(other);
+  }
+
+  void swap(trans_graphs &other) {
+    _by_tid.swap(other._by_tid);
+    _trans.swap(other._trans);
+    _vids.swap(other._vids);
+    _vlbls.swap(other._vlbls);
+    _row_ptr.swap(other._row_ptr);
+    _adj.swap(other._adj);
+    _elbls.swap(other._elbls);
+  }
+
+  unsigned int num_trans() const { return _trans.size(); }
+
+  /** Vertex with input id vid in transaction tid, or -1 */
+  int vertex(const int &tid, const int &vid) const {
+    if (tid < 0 || (unsigned int)tid >= _by_tid.size() || _by_tid[tid] < 0)
+      return -1;
+    const trans &t = _trans[_by_tid[tid]];
+    if (!t.nv)
+      return -1;
+    const int *b = &_vids[t.first], *e = b + t.nv;
+    long k = (long)vid - b[0];
+    if (k >= 0 && k < (long)t.nv && b[k] == vid) // dense vids
+      return t.first + k;
+    const int *p = lower_bound(b, e, vid);
+    return (p != e && *p == vid) ? (int)(p - &_vids[0]) : -1;
+  }
+
+  int vid(const int &v) const { return _vids[v]; }
+  const V_T &label(const int &v) const { return _vlbls[v]; }
+
+  unsigned int adj_begin(const int &v) const { return _row_ptr[v]; }
+  unsigned int adj_end(const int &v) const { return _row_ptr[v + 1]; }
+
+  /** The neighbour, and the label of the edge to it, of adjacency entry k */
+  int neighbor(const unsigned int &k) const { return _adj[k]; }
+  const E_T &edge_label(const unsigned int &k) const { return _elbls[k]; }
+
+private:
+  struct trans {
+    unsigned int first; // first vertex
+    unsigned int nv;    // number of vertices
+  };
+
+  void set_trans(const int &tid, const int &idx) {
+    if (tid < 0)
+      return;
+    if ((unsigned int)tid >= _by_tid.size())
+      _by_tid.resize(tid + 1, -1);
+    _by_tid[tid] = idx;
+  }
+
+  vector<int> _by_tid;            // index in _trans of each tid, or -1
+  vector<trans> _trans;           // in the order they were added
+  vector<int> _vids;              // input vertex id of each vertex
+  vector<V_T> _vlbls;             // label of each vertex
+  vector<unsigned int> _row_ptr;  // first adjacency entry of each vertex
+  vector<int> _adj;               // neighbour of each adjacency entry
+  vector<E_T> _elbls;             // edge label of each adjacency entry
+
+}; // end class trans_graphs
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+/** \file walk_trace.h - binary trace of the random walks, one record per
+ * walk; see walk_trace_reader.cpp for printing it */
+#ifndef _WALK_TRACE_H
+#define _WALK_TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Layout of a walk trace, all integers in host byte order:
+ *
+ *   header   walk_trace_header
+ *   records  one walk_record per walk, in the order the walks ended
+ */
+
+#define WALK_TRACE_MAGIC "DMTLWTR1"
+#define WALK_TRACE_VERSION 1
+
+struct walk_trace_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size; // sizeof(walk_record)
+};
+
+/** What a walk records about itself, see gen_random_max_graph() */
+struct walk_shape {
+  uint32_t steps;          // extensions counted
+  uint32_t failed;         // of those, the ones that extended nothing
+  uint64_t peak_vat_bytes; // largest VAT of the walk's pattern
+
+  walk_shape() : steps(0), failed(0), peak_vat_bytes(0) {}
+};
+
+struct walk_record {
+  uint64_t walk;           // number of the walk, from 1, in start order
+  uint64_t wall_ns;        // time the walk took
+  uint64_t peak_vat_bytes; // see walk_shape
+  int32_t start;           // level-one pattern the walk started from
+  uint32_t steps;          // see walk_shape
+  uint32_t failed;         // see walk_shape
+  uint32_t edges;          // of the maximal pattern reached
+  uint16_t vertices;       // of the maximal pattern reached
+  uint16_t thread;         // worker that ran the walk
+  uint8_t duplicate;       // 1 if that pattern had been found before
+  uint8_t pad[3];
+};
+
+static_assert(sizeof(walk_record) == 48, "walk_record must stay 48 bytes");
+
+/**
+ * \brief Writes walk records to a trace file from a background thread.
+ *
+ * add() only queues the record; once BATCH records are queued, the writer
+ * thread takes them all and writes them out while the walks go on. close(),
+ * or the destructor, writes what is left, and reports if any write failed.
+ */
+class walk_trace_writer {
+public:
+  static const unsigned int BATCH = 1024;
+
+  /** Creates the trace file path, exiting if it cannot be written */
+  explicit walk_trace_writer(const char *path)
+      : _out(path, ios::binary | ios::trunc), _path(path), _closing(false) {
+    if (!_out) {
+      cerr << "walk_trace_writer: cannot write " << path << endl;
+      exit(1);
+    }
+    walk_trace_header hdr;
+    memcpy(hdr.magic, WALK_TRACE_MAGIC, 8);
+    hdr.version = WALK_TRACE_VERSION;
+    hdr.record_size = sizeof(walk_record);
+    _out.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    _pending.reserve(BATCH);
+    _writer = thread(&walk_trace_writer::write_loop, this);
+  }
+
+  ~walk_trace_writer() { close(); }
+
+  /** Queues r; safe to call from any thread */
+  void add(const walk_record &r) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _pending.push_back(r);
+    if (_pending.size() >= BATCH)
+      _ready.notify_one();
+  }
+
+  /** Writes all queued records and closes the file; returns false, and
+   * prints the reason, if the trace could not be written in full */
+  bool close() {
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      if (_closing)
+        return !_out.fail();
+      _closing = true;
+    }
+    _ready.notify_one();
+    _writer.join();
+    _out.close(); // flushes, and fails if that does
+    if (!_out) {
+      cerr << "walk_trace_writer: error writing " << _path << endl;
+      return false;
+    }
+    return true;
+  }
+
+private:
+  void write_loop() {
+    vector<walk_record> batch;
+    batch.reserve(BATCH);
+    std::unique_lock<std::mutex> guard(_lock);
+    while (true) {
+      _ready.wait(guard,
+                  [this]() { return _closing || _pending.size() >= BATCH; });
+      batch.swap(_pending);
+      bool last = _closing;
+      guard.unlock();
+      _out.write(reinterpret_cast<const char *>(batch.data()),
+                 batch.size() * sizeof(walk_record));
+      batch.clear();
+      if (last)
+        return;
+      guard.lock();
+    }
+  }
+
+  ofstream _out; // once a write fails, the rest are not made
+  string _path;
+  std::mutex _lock;
+  std::condition_variable _ready;
+  vector<walk_record> _pending; // queued by add(), taken by the writer
+  bool _closing;
+  thread _writer;
+
+}; // end class walk_trace_writer
+
+/**
+ * Reads the records of the trace file path into records; returns false and
+ * prints the reason if it is not a walk trace.
+ */
+inline bool read_walk_trace(const char *path, vector<walk_record> &records) {
+  ifstream in(path, ios::binary);
+  walk_trace_header hdr;
+  if (!in.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) ||
+      memcmp(hdr.magic, WALK_TRACE_MAGIC, 8)) {
+    cerr << "read_walk_trace: " << path << " is not a walk trace" << endl;
+    return false;
+  }
+  if (hdr.version != WALK_TRACE_VERSION ||
+      hdr.record_size != sizeof(walk_record)) {
+    cerr << "read_walk_trace: unsupported version " << hdr.version << endl;
+    return false;
+  }
+  walk_record r;
+  while (in.read(reinterpret_cast<char *>(&r), sizeof(r)))
+    records.push_back(r);
+  return true;
+}
+
+#endif
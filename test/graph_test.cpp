@@ -46,8 +46,10 @@ unsigned long int freq_pats_count = 0;
 bool print = false;
 
 #include "count_support.h"
+#include "graph_arena_vat.h"
 #include "graph_can_code.h"
 #include "graph_iso_check.h"
+#include "graph_linked_vat.h"
 #include "graph_operators.h"
 #include "graph_vat.h"
 #include "pattern.h"
@@ -55,9 +57,14 @@ bool print = false;
 #include "time_tracker.h"
 
 #include "db_reader.h"
+#include "edge_triples.h"
 #include "graph_tokenizer.h"
 #include "level_one_hmap.h"
+#include "metrics.h"
+#include "orthogonal_reps.h"
+#include "parallel_walk.h"
 #include "pat_fam.h"
+#include "walk_trace.h"
 
 #include "mem_storage_manager.h"
 typedef unsigned int uint;
@@ -65,6 +72,9 @@ typedef unsigned int uint;
 #define GRAPH_PR proplist<undirected>
 #define GRAPH_MINE_PR proplist<Fk_F1, proplist<vert_mine>>
 #define DMTL_TKNZ_PR proplist<dmtl_format>
+// VAT layout: arena_storage packs embeddings, linked_storage links them to
+// the parent VAT's, std::vector is the original one
+#define VAT_ST arena_storage
 // #define PRINT
 
 time_tracker tt_total;
@@ -72,15 +82,71 @@ time_tracker tt_total;
 int minsup;
 int tot_max_pats;
 char *infile;
+unsigned int num_threads = 1;
+double rep_alpha = -1; // no representatives are selected unless it is given
+double rep_beta = 0.5;
+unsigned int verdict_bits = 20; // log2 of the verdict cache slots, 0 for none
+bool verdict_bloom = false;
+unsigned long int vat_cache_mb = 64; // budget of the VAT cache, 0 for none
+bool enum_walks = false; // walks enumerate the frequent extensions
+char *metrics_file = 0;  // where the metrics go at exit and on SIGUSR1
+char *trace_file = 0;    // where the walk records go, see walk_trace.h
+unsigned long max_idle_walks = 999; // idle walks to stop at, 0 for none
+double min_gain = 0; // coverage gain per CPU-second to go on, 0 for none
+double deadline = 0; // seconds of walking, 0 for none
+unsigned int seed = 0;  // of the walks and representative selection
+bool seed_given = false; // the seed is taken from the clock otherwise
 
 void print_usage(char *prog) {
   cerr << "Usage: " << prog
        << " -i input-filename -s minsup -tm <# of max patterns> -rate [-p]"
-       << endl;
+       << " [-t <# of threads>] [-alpha <a> [-beta <b>]] [-vc <bits>] [-bloom]"
+       << " [-vcache <MB>] [-enum] [-metrics <file>]"
+       << " [-trace <file>] [-idle <walks>] [-gain <g>] [-deadline <secs>]"
+       << " [-seed <n>]" << endl;
   cerr
       << "Input file should be in ASCII (plain text), minsup is a whole integer"
       << endl;
   cerr << "Append -p to print out frequent patterns" << endl;
+  cerr << "-tm stops after that many distinct maximal patterns; 0 is no "
+          "limit, the walks end by -idle, -gain or -deadline"
+       << endl;
+  cerr << "-t reads the database and runs the random walks on that many "
+          "threads, at least 1 (default 1)"
+       << endl;
+  cerr << "-alpha selects an alpha-orthogonal set of the maximal patterns "
+          "that beta-represents the others (similarities in [0,1], "
+          "default beta 0.5)"
+       << endl;
+  cerr << "-vc remembers the verdicts of 2^bits candidates across walks "
+          "(default 20, 0 for none); -bloom puts a Bloom filter in front"
+       << endl;
+  cerr << "-vcache keeps that many MB of candidate VATs across walks "
+          "(default 64, 0 for none)"
+       << endl;
+  cerr << "-enum keeps the transaction graphs in memory, and has each walk "
+          "step pick among the frequent extensions found in them"
+       << endl;
+  cerr << "-metrics writes the counters and timers of the run to file as "
+          "JSON, at exit and whenever the process gets SIGUSR1"
+       << endl;
+  cerr << "-trace writes a binary record of every walk to file, for "
+          "walk_trace_reader"
+       << endl;
+  cerr << "-idle stops after that many walks in a row found no new maximal "
+          "pattern (default 999, 0 for no limit)"
+       << endl;
+  cerr << "-gain stops once the walks of a CPU-second are expected to add "
+          "less than that share of the estimated maximal patterns (e.g. "
+          "0.001; default 0, no limit)"
+       << endl;
+  cerr << "-deadline stops the walks after that many seconds, abandoning "
+          "those under way (default 0, no limit)"
+       << endl;
+  cerr << "-seed seeds the random walks and the representative selection; "
+          "with one thread, the same seed gives the same output (default: "
+          "the clock, printed as seed)"
+       << endl;
   exit(0);
 }
 
@@ -99,6 +165,48 @@ void parse_args(int argc, char *argv[]) {
     } else if (strcmp(argv[i], "-tm") == 0) {
       tot_max_pats = atoi(argv[++i]);
       std::cout << "tot_max_pats: " << tot_max_pats << std::endl;
+    } else if (strcmp(argv[i], "-t") == 0) {
+      int t = atoi(argv[++i]);
+      if (t < 1)
+        print_usage(argv[0]);
+      num_threads = t;
+      std::cout << "threads: " << num_threads << std::endl;
+    } else if (strcmp(argv[i], "-alpha") == 0) {
+      rep_alpha = atof(argv[++i]);
+      std::cout << "alpha: " << rep_alpha << std::endl;
+    } else if (strcmp(argv[i], "-beta") == 0) {
+      rep_beta = atof(argv[++i]);
+      std::cout << "beta: " << rep_beta << std::endl;
+    } else if (strcmp(argv[i], "-vc") == 0) {
+      verdict_bits = atoi(argv[++i]);
+      std::cout << "verdict cache bits: " << verdict_bits << std::endl;
+    } else if (strcmp(argv[i], "-bloom") == 0) {
+      verdict_bloom = true;
+      std::cout << "bloom: " << verdict_bloom << std::endl;
+    } else if (strcmp(argv[i], "-vcache") == 0) {
+      vat_cache_mb = atol(argv[++i]);
+      std::cout << "VAT cache MB: " << vat_cache_mb << std::endl;
+    } else if (strcmp(argv[i], "-enum") == 0) {
+      enum_walks = true;
+      std::cout << "enum: " << enum_walks << std::endl;
+    } else if (strcmp(argv[i], "-metrics") == 0) {
+      metrics_file = argv[++i];
+      std::cout << "metrics: " << metrics_file << std::endl;
+    } else if (strcmp(argv[i], "-trace") == 0) {
+      trace_file = argv[++i];
+      std::cout << "trace: " << trace_file << std::endl;
+    } else if (strcmp(argv[i], "-idle") == 0) {
+      max_idle_walks = strtoul(argv[++i], 0, 10);
+      std::cout << "idle: " << max_idle_walks << std::endl;
+    } else if (strcmp(argv[i], "-gain") == 0) {
+      min_gain = atof(argv[++i]);
+      std::cout << "gain: " << min_gain << std::endl;
+    } else if (strcmp(argv[i], "-deadline") == 0) {
+      deadline = atof(argv[++i]);
+      std::cout << "deadline: " << deadline << std::endl;
+    } else if (strcmp(argv[i], "-seed") == 0) {
+      seed = strtoul(argv[++i], 0, 10);
+      seed_given = true;
     } else if (strcmp(argv[i], "-p") == 0) {
       print = true;
       std::cout << "print: " << print << std::endl;
@@ -133,30 +241,47 @@ vector<int>::iterator random_starting_edge_index(vector<int> &sumlist,
 
 int main(int argc, char *argv[]) {
 
-  // COMMENT: For dealing with dataset in int format. Comment out the next
-  // line and
-  //          uncomment the line after that.
-  typedef adj_list<std::string, std::string> PAT_ST;
+  // COMMENT: Labels are read as strings and mined as their ids in
+  //          label_dict (see element_parser<dict_label>). For plain string
+  //          labels use adj_list<std::string, std::string> instead.
+  typedef adj_list<dict_label, dict_label> PAT_ST;
   typedef pattern<GRAPH_PR, GRAPH_MINE_PR, PAT_ST, canonical_code> GRAPH_PAT;
-  typedef vat<GRAPH_PR, GRAPH_MINE_PR, std::vector> GRAPH_VAT;
+  typedef vat<GRAPH_PR, GRAPH_MINE_PR, VAT_ST> GRAPH_VAT;
 
-  level_one_hmap<GRAPH_PAT::VERTEX_T, GRAPH_PAT::EDGE_T> l1_map;
-  map<pair<pair<GRAPH_PAT::VERTEX_T, GRAPH_PAT::VERTEX_T>, GRAPH_PAT::EDGE_T>,
+  typedef level_one_hmap<GRAPH_PAT::VERTEX_T, GRAPH_PAT::EDGE_T> L1_MAP;
+  typedef level_one_csr<GRAPH_PAT::VERTEX_T, GRAPH_PAT::EDGE_T> L1_CSR;
+  typedef map<
+      pair<pair<GRAPH_PAT::VERTEX_T, GRAPH_PAT::VERTEX_T>, GRAPH_PAT::EDGE_T>,
       int>
-      edge_freq;
+      EDGE_FREQ;
+  typedef edge_triples<GRAPH_PAT::VERTEX_T, GRAPH_PAT::EDGE_T> TRIPLES;
+  typedef storage_manager<GRAPH_PAT, GRAPH_VAT, concurrent_memory_storage>
+      VAT_MAP;
+
+  L1_MAP l1_map;
+  EDGE_FREQ edge_freq;
   // typedef edge_counter<GRAPH_PAT::VERTEX_T, GRAPH_PAT::EDGE_T> PAT_AS_EDGE;
 
   parse_args(argc, argv);
+  if (metrics_file) // before the reader and walker threads are started
+    metrics::dump_to(metrics_file);
   pat_fam<GRAPH_PAT> level_one_pats;
   pat_fam<GRAPH_PAT> copy_of_level_one_pats;
   pat_fam<GRAPH_PAT> freq_pats;
   pat_fam<GRAPH_PAT> max_pats;
 
-  storage_manager<GRAPH_PAT, GRAPH_VAT, memory_storage> vat_map;
+  VAT_MAP vat_map;
 
   db_reader<GRAPH_PAT, DMTL_TKNZ_PR> dbr(infile);
+  db_reader<GRAPH_PAT, DMTL_TKNZ_PR>::TRANS_DB trans_db;
+  if (enum_walks)
+    dbr.keep_trans(&trans_db);
   cout << "getting length one\n";
-  dbr.get_length_one(level_one_pats, vat_map, minsup, edge_freq);
+  dbr.get_length_one(level_one_pats, vat_map, minsup, edge_freq, num_threads);
+  metric_timer tt_triples(metrics::LEVEL_ONE);
+  TRIPLES triples; // dense ids of the frequent edges, for the walks
+  triples.add_patterns(level_one_pats, edge_freq);
+  tt_triples.stop();
   cout << "Done\n";
 
 #ifdef PRINT
@@ -184,95 +309,81 @@ int main(int argc, char *argv[]) {
   }
   freq_pats = level_one_pats;
 
+  metric_timer tt_l1_map(metrics::LEVEL_ONE);
   populate_level_one_map(freq_pats, l1_map);
+  L1_CSR l1_csr(l1_map, triples); // what the walks draw their edges from
+  tt_l1_map.stop();
   l1_map.print();
-  count_support<GRAPH_PR, GRAPH_MINE_PR, PAT_ST, canonical_code, memory_storage>
-      cs(vat_map);
-
-  srand((unsigned)time(0)); // initializing random-seed
+  typedef count_support<GRAPH_PR, GRAPH_MINE_PR, PAT_ST, canonical_code,
+                        concurrent_memory_storage, VAT_ST>
+      CS;
 
   /// This is for stopping condition  /////////
-  map<std::string, int> all_pat;
-  set<std::string, int> max_pat;
-  pat_fam<GRAPH_PAT>::iterator pit;
-  i = 1;
-  int last_updated = i;
-  int max_count = 0;
+  stop_policy stop(tot_max_pats, max_idle_walks);
+  if (min_gain > 0)
+    stop.set_min_gain(min_gain);
+  if (deadline > 0)
+    stop.set_deadline(deadline);
+  // random cliques tried, and local search steps, in representative selection
+  const unsigned int rep_restarts = 20;
+  if (!seed_given)
+    seed = (unsigned)time(0);
+  cout << "seed: " << seed << endl;
 
-  long failed = 0;
   tt_total.start();
-  vector<vector<bool>> matrix;
-  uint row_size = dbr.get_transaction_count();
-  vector<pair<uint, uint>> stat;
-  do {
-    vector<bool> one_row(row_size, 0);
-    vector<uint> all_tids;
-    int index = randint(0, level_one_pats.size());
-    pit = level_one_pats.begin() + index;
-    GRAPH_PAT *saved_copy = (*pit)->exact_clone();
-
-    int prev_failed = failed;
-    // cout << "calling random graph\n";
-
-    gen_random_max_graph(*pit, l1_map, minsup, cs, edge_freq, all_pat, stat,
-                         failed);
-
-    /// The following condition true means it is a new pattern
-    if (failed == prev_failed) {
-      // cout << "pattern no:" << i << endl;
-      // const GRAPH_PAT::CAN_CODE& cc = check_isomorphism(*pit);
-      // cout << "Min DFS code= " << cc.to_string() << endl;
-
-      // Tids in which this pattern occurs
-      max_count++; // increment the number of max graphs.
-      last_updated = i;
-      if ((max_count != 0) && (max_count % 10 == 0)) {
-        tt_total.stop();
-        // cout << "Time for " << max_count << " graphs = " <<
-        // tt_total.print()
-        // << " sec." << endl;
-        tt_total.start();
-      }
-
-      // Delete the max vat now..
-      if ((*pit)->size() > 2)
-        cs.delete_vat(*pit);
-    }
-
-    if ((*pit)->size() > 1) {
-      if (failed == prev_failed) {
-        cout << *pit << endl;
-      }
-      delete *pit;
-      level_one_pats[index] = saved_copy;
-    } else {
-      cout << level_one_pats[index] << endl;
-      delete *pit;
-      level_one_pats[index] = saved_copy;
-    }
-
-    // max_pats.push_back(*pit);
-
-    // cout << "Current " << i << " iteration: number of max-graph:" <<
-    // max_count
-    //      << endl;
-    // cout <<
-    // "################################################################"
-    //         "##"
-    //         "#####"
-    //      << endl;
-    i++;
-    // system("top -b | grep graph_test > _mem_footprint");
-
-  } while (max_count < tot_max_pats && i - last_updated < 1000);
-  // TODO: make this threshold 1000 a command line argument
-  // while (i < 120400);
+  walk_engine<CS, VAT_MAP, L1_CSR, TRIPLES> walker(level_one_pats, l1_csr,
+                                                   triples, vat_map, minsup);
+  walker.keep_tids(rep_alpha >= 0);
+  walker.use_verdicts(verdict_bits, verdict_bloom);
+  walker.use_vat_cache(vat_cache_mb << 20);
+  if (enum_walks)
+    walker.use_enumeration(&trans_db);
+  walk_trace_writer *trace = trace_file ? new walk_trace_writer(trace_file) : 0;
+  walker.trace_walks(trace);
+  walker.run(num_threads, stop, seed);
+  delete trace; // writes the records still queued, reporting write errors
+  stop_policy::sample done = walker.sample();
+  cout << "Stopped after " << done.walks << " walks: "
+       << stop_policy::describe(walker.stop_reason())
+       << ", coverage " << stop_policy::coverage(done) << ", about "
+       << (unsigned long)stop_policy::estimated_total(done)
+       << " maximal patterns" << endl;
+  if (walker.verdicts())
+    cout << "Verdict cache: " << walker.verdicts()->hits() << " of "
+         << walker.verdicts()->lookups() << " candidates known" << endl;
+  if (walker.vat_cache())
+    cout << "VAT cache: " << walker.vat_cache()->hits() << " hits, "
+         << walker.vat_cache()->misses() << " misses, "
+         << walker.vat_cache()->evictions() << " evictions, "
+         << (walker.vat_cache()->bytes() >> 20) << " MB held" << endl;
 
   // creating statistics of failed iterations
   cout << "Statistics\n";
-  map<std::string, int>::const_iterator apit;
+  map<code_key, int> all_keys;
+  walker.all_pat().merge_into(all_keys);
+  map<std::string, int> all_pat; // printed in the order of the codes' text
+  for (auto kv_pair : all_keys)
+    all_pat.insert(make_pair(GRAPH_PAT::CAN_CODE::to_string(kv_pair.first),
+                             kv_pair.second));
   for (auto kv_pair : all_pat) {
     cout << kv_pair.first << "(" << kv_pair.second << ")" << endl;
   }
+
+  if (rep_alpha >= 0) {
+    time_tracker tt_reps;
+    tt_reps.start();
+    orthogonal_reps<code_key> reps(rep_alpha, rep_beta);
+    for (auto &sample : walker.samples())
+      reps.add(sample.first, sample.second);
+    reps.select(rep_restarts, seed);
+    tt_reps.stop();
+
+    cout << "Orthogonal representatives: " << reps.reps().size() << " of "
+         << reps.size() << ", residue " << reps.residue() << " (alpha "
+         << rep_alpha << ", beta " << rep_beta << ", " << tt_reps.print()
+         << " sec)" << endl;
+    for (unsigned int k = 0; k < reps.reps().size(); k++)
+      cout << GRAPH_PAT::CAN_CODE::to_string(reps.key(reps.reps()[k])) << endl;
+  }
   tt_total.stop();
 } // main()
@@ -0,0 +1,176 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/** \file graph_to_bin.cpp - converts a graph database from the ASCII
+ * (t # / v / e) format to the binary format of graph_bin_format.h, which
+ * db_reader recognizes and memory-maps. The input is checked the same way
+ * graph_tokenizer.h checks it. */
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "graph_bin_format.h"
+
+using namespace std;
+
+char *infile;
+char *outfile;
+
+void print_usage(char *prog) {
+  cerr << "Usage: " << prog << " -i input-filename -o output-filename" << endl;
+  cerr << "Input file should be in ASCII (plain text), the output is binary"
+       << endl;
+  exit(0);
+}
+
+void parse_args(int argc, char *argv[]) {
+  if (argc < 5) {
+    print_usage(argv[0]);
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      infile = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      outfile = argv[++i];
+    } else {
+      print_usage(argv[0]);
+    }
+  }
+}
+
+vector<std::string> split_line(const std::string &line) {
+  vector<std::string> tokens;
+  std::string token;
+  istringstream tokenStream(line);
+  while (getline(tokenStream, token, ' '))
+    tokens.push_back(token);
+  return tokens;
+}
+
+/** The transaction being read */
+struct ascii_trans {
+  int tid;
+  map<int, uint32_t> vid_to_pos; // vertex id to its position
+  vector<int32_t> vids;
+  vector<uint32_t> vlbls;
+  vector<uint32_t> edges;
+
+  void clear() {
+    tid = -1;
+    vid_to_pos.clear();
+    vids.clear();
+    vlbls.clear();
+    edges.clear();
+  }
+};
+
+int main(int argc, char *argv[]) {
+  parse_args(argc, argv);
+
+  ifstream in(infile);
+  if (!in.is_open()) {
+    cerr << "graph_to_bin: cannot open " << infile << endl;
+    return 1;
+  }
+
+  graph_bin_writer out;
+  if (!out.open(outfile)) {
+    cerr << "graph_to_bin: cannot create " << outfile << endl;
+    return 1;
+  }
+
+  ascii_trans t;
+  t.clear();
+  std::string line;
+  int lineno = 0;
+  unsigned long num_edges = 0;
+
+  // as in graph_tokenizer.h, an empty line ends the database
+  while (getline(in, line) && line.length() > 0) {
+    lineno++;
+    if (line.at(0) == '#') // comment line
+      continue;
+
+    vector<std::string> tokens = split_line(line);
+    if (tokens.size() < 3) {
+      cerr << "Input file may have error at lineno:" << lineno << endl;
+      return 1;
+    }
+
+    if (tokens[0] == "t") {
+      if (tokens[1] != "#") {
+        cerr << "Input file may have error at lineno:" << lineno << endl;
+        return 1;
+      }
+      if (t.tid != -1)
+        out.add_trans(t.tid, t.vids, t.vlbls, t.edges);
+      t.clear();
+      t.tid = atoi(tokens[2].c_str());
+    } else if (tokens[0] == "v") {
+      if (tokens.size() != 3 || t.tid == -1) {
+        cerr << "Input file may have error at lineno:" << lineno << endl;
+        return 1;
+      }
+      int vid = atoi(tokens[1].c_str());
+      if (t.vid_to_pos.count(vid)) // the first label of a vertex is kept
+        continue;
+      t.vid_to_pos.insert(make_pair(vid, (uint32_t)t.vids.size()));
+      t.vids.push_back(vid);
+      t.vlbls.push_back(out.vertex_label_id(tokens[2]));
+    } else if (tokens[0] == "e") {
+      if (tokens.size() != 4 || t.tid == -1) {
+        cerr << "Input file may have error at lineno:" << lineno << endl;
+        return 1;
+      }
+      int vid1 = atoi(tokens[1].c_str()), vid2 = atoi(tokens[2].c_str());
+      map<int, uint32_t>::const_iterator it1 = t.vid_to_pos.find(vid1);
+      map<int, uint32_t>::const_iterator it2 = t.vid_to_pos.find(vid2);
+      if (it1 == t.vid_to_pos.end() || it2 == t.vid_to_pos.end()) {
+        cerr << "graph_to_bin: vid " << vid1 << " not found at lineno:"
+             << lineno << endl;
+        return 1;
+      }
+      t.edges.push_back(it1->second);
+      t.edges.push_back(it2->second);
+      t.edges.push_back(out.edge_label_id(tokens[3]));
+      num_edges++;
+    } else {
+      cerr << "graph_to_bin: Unidentifiable line=" << line << endl;
+      return 1;
+    }
+  }
+  if (t.tid != -1)
+    out.add_trans(t.tid, t.vids, t.vlbls, t.edges);
+
+  unsigned int num_trans = out.num_trans();
+  if (!out.close()) {
+    cerr << "graph_to_bin: error writing " << outfile << endl;
+    return 1;
+  }
+  cout << "Wrote " << num_trans << " transactions, " << num_edges
+       << " edges to " << outfile << endl;
+  return 0;
+}
@@ -0,0 +1,576 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/** \file kernel_check.cpp - checks the packed and word-parallel kernels
+ * against plain versions of the same computation: code_key packing against
+ * the canonical code's text, tid_bitset intersections against sorted
+ * vectors, the minimum DFS code search against minimal() and extend(), and
+ * the arena and linked VAT layouts against the std::vector one. Prints
+ * every mismatch and exits with 1 if there was any. */
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+unsigned long int freq_pats_count = 0;
+bool print = false;
+
+#include "helper_funs.h"
+#include "incidence_index.h"
+#include "time_tracker.h"
+
+#include "graph_arena_vat.h"
+#include "graph_can_code.h"
+#include "graph_linked_vat.h"
+#include "graph_operators.h"
+#include "graph_vat.h"
+#include "label_dict.h"
+#include "pattern.h"
+#include "properties.h"
+#include "random_max-graph.h"
+#include "tid_bitset.h"
+
+#include "conc_storage_manager.h"
+#include "db_reader.h"
+#include "graph_tokenizer.h"
+#include "pat_fam.h"
+
+using namespace std;
+
+typedef unsigned int uint;
+
+#ifndef DATA_DIR
+#define DATA_DIR "../data"
+#endif
+
+#define GRAPH_PR proplist<undirected>
+#define GRAPH_MINE_PR proplist<Fk_F1, proplist<vert_mine>>
+#define DMTL_TKNZ_PR proplist<dmtl_format>
+
+typedef adj_list<dict_label, dict_label> PAT_ST;
+typedef pattern<GRAPH_PR, GRAPH_MINE_PR, PAT_ST, canonical_code> GRAPH_PAT;
+typedef GRAPH_PAT::VERTEX_T V_T;
+typedef GRAPH_PAT::EDGE_T E_T;
+typedef map<pair<pair<V_T, V_T>, E_T>, int> EDGE_FREQ;
+typedef pattern_support<GRAPH_MINE_PR> PAT_SUP;
+
+unsigned int failures = 0;
+
+void fail(const string &what) {
+  cerr << "FAILED: " << what << endl;
+  failures++;
+}
+
+/** Varints and zigzag ints read back as written, at the width boundaries */
+void check_varints() {
+  const uint64_t us[] = {0,     1,          127,        128,
+                         16383, 16384,      UINT32_MAX, 1ULL << 35,
+                         UINT64_MAX - 1,    UINT64_MAX};
+  const int is[] = {0, 1, -1, 63, -64, 64, -65, INT_MAX, INT_MIN};
+  string out;
+  for (unsigned int k = 0; k < sizeof(us) / sizeof(us[0]); k++)
+    put_varint(out, us[k]);
+  for (unsigned int k = 0; k < sizeof(is) / sizeof(is[0]); k++)
+    put_varint(out, is[k]);
+
+  const char *p = out.data();
+  for (unsigned int k = 0; k < sizeof(us) / sizeof(us[0]); k++)
+    if (get_varint(p) != us[k])
+      fail("varint " + to_string(us[k]));
+  for (unsigned int k = 0; k < sizeof(is) / sizeof(is[0]); k++)
+    if (get_int(p) != is[k])
+      fail("zigzag int " + to_string(is[k]));
+  if (p != out.data() + out.size())
+    fail("varints read past what was written");
+}
+
+// random labels of each type the codes are mined with
+dict_label random_label(mt19937 &rng, dict_label *) {
+  static const char *texts[] = {"C", "N", "O", "S", "Cl", "-", "=", "#"};
+  return dict_label(label_dict::instance().id(texts[rng() % 8]));
+}
+
+int random_label(mt19937 &rng, int *) { return (int)(rng() % 2001) - 1000; }
+
+string random_label(mt19937 &rng, string *) {
+  string s(rng() % 4, 'a');
+  for (unsigned int k = 0; k < s.size(); k++)
+    s[k] += rng() % 26;
+  return s;
+}
+
+/**
+ * code_key of random codes, of up to 40 tuples with ids of all sizes, reads
+ * back to the code's own text, by key() and by key(next) alike.
+ */
+template <typename L> void check_code_keys(const string &type) {
+  typedef canonical_code<GRAPH_PR, L, L> CODE;
+  typedef typename CODE::FIVE_TUPLE TUPLE;
+
+  mt19937 rng(7);
+  L *tag = 0;
+  for (unsigned int round = 0; round < 500; round++) {
+    CODE code;
+    unsigned int n = 1 + rng() % 40;
+    for (unsigned int k = 0; k < n; k++) {
+      int i = rng() % 3 ? (int)(rng() % 64) : (int)rng();
+      int j = rng() % 5 ? (int)(rng() % 64) : -(int)(rng() % 1000) - 1;
+      code.append(TUPLE(i, j, random_label(rng, tag), random_label(rng, tag),
+                        random_label(rng, tag)));
+    }
+
+    code_key k = code.key();
+    if (CODE::to_string(k) != code.to_string())
+      fail(type + " code_key of " + code.to_string() + " reads back as " +
+           CODE::to_string(k));
+
+    TUPLE next(rng() % 64, rng() % 64, random_label(rng, tag),
+               random_label(rng, tag), random_label(rng, tag));
+    code_key kn = code.key(next);
+    code.append(next);
+    if (kn != code.key())
+      fail(type + " key(next) differs from key() of " + code.to_string());
+    if (CODE::to_string(kn) != code.to_string())
+      fail(type + " code_key of " + code.to_string() + " reads back as " +
+           CODE::to_string(kn));
+  }
+}
+
+// a sorted set of tids in [lo, lo + span), each there with chance density
+vector<unsigned int> random_tids(mt19937 &rng, const unsigned int &lo,
+                                 const unsigned int &span,
+                                 const double &density) {
+  vector<unsigned int> tids;
+  uniform_real_distribution<double> coin(0, 1);
+  for (unsigned int t = lo; t < lo + span; t++)
+    if (coin(rng) < density)
+      tids.push_back(t);
+  return tids;
+}
+
+tid_bitset to_bitset(const vector<unsigned int> &tids) {
+  tid_bitset b;
+  for (unsigned int k = 0; k < tids.size(); k++)
+    b.push_back(tids[k]);
+  return b;
+}
+
+/**
+ * count_common() and for_common() of random tid sets, of several densities
+ * and overlaps, against set_intersection of the sorted tids; for_common()
+ * must also give the rank of each common tid in both sets.
+ */
+void check_tid_bitsets() {
+  mt19937 rng(11);
+  const double densities[] = {0.001, 0.02, 0.3, 0.9, 1.0};
+  for (unsigned int round = 0; round < 2000; round++) {
+    double da = densities[rng() % 5], db = densities[rng() % 5];
+    vector<unsigned int> a =
+        random_tids(rng, rng() % 300, 1 + rng() % 2000, da);
+    vector<unsigned int> b =
+        random_tids(rng, rng() % 300, 1 + rng() % 2000, db);
+    tid_bitset ba = to_bitset(a), bb = to_bitset(b);
+    // pop_back() must leave the set as if the tid was never added
+    unsigned int extra = (b.empty() ? 5000 : b.back() + 1) + rng() % 200;
+    bb.push_back(extra);
+    bb.pop_back(extra);
+
+    vector<unsigned int> common;
+    set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                     back_inserter(common));
+
+    string what = "round " + to_string(round) + ": ";
+    if (ba.size() != a.size() || bb.size() != b.size())
+      fail(what + "size");
+    if (tid_bitset::count_common(ba, bb) != common.size())
+      fail(what + "count_common " +
+           to_string(tid_bitset::count_common(ba, bb)) + " for " +
+           to_string(common.size()) + " common tids");
+    if (tid_bitset::count_common(bb, ba) != common.size())
+      fail(what + "count_common is not symmetric");
+
+    unsigned int seen = 0;
+    bool ok = true;
+    tid_bitset::for_common(
+        ba, bb,
+        [&](const unsigned int &tid, const unsigned int &ra,
+            const unsigned int &rb) {
+          if (seen >= common.size() || common[seen] != tid ||
+              ra >= a.size() || a[ra] != tid || rb >= b.size() ||
+              b[rb] != tid)
+            ok = false;
+          seen++;
+        });
+    if (!ok || seen != common.size())
+      fail(what + "for_common gives other tids or ranks");
+  }
+}
+
+/**
+ * incidence_index::find() of random level-one rows, some with both ends on
+ * one vertex, against a scan of the rows; the index is built once by add()
+ * alone and once in two parts joined by append(), split at any row.
+ */
+void check_incidence_index() {
+  struct row {
+    unsigned int block; // rank of the tid among those with rows
+    int idx;            // row within the tid
+    int a, b;
+  };
+  mt19937 rng(13);
+  for (unsigned int round = 0; round < 200; round++) {
+    unsigned int num_vids = 1 + rng() % 30;
+    vector<row> rows;
+    unsigned int num_blocks = 1 + rng() % 20;
+    for (unsigned int t = 0; t < num_blocks; t++) {
+      unsigned int n = 1 + rng() % 40;
+      for (unsigned int r = 0; r < n; r++)
+        rows.push_back(row{t, (int)r, (int)(rng() % num_vids),
+                           (int)(rng() % num_vids)});
+    }
+
+    incidence_index whole, first, second;
+    unsigned int split = rng() % (rows.size() + 1);
+    for (unsigned int k = 0; k < rows.size(); k++)
+      whole.add(rows[k].block, rows[k].a, rows[k].b, rows[k].idx);
+    for (unsigned int k = 0; k < split; k++)
+      first.add(rows[k].block, rows[k].a, rows[k].b, rows[k].idx);
+    // the second part is indexed on its own, from its first tid and row
+    for (unsigned int k = split; k < rows.size(); k++)
+      second.add(rows[k].block - rows[split].block, rows[k].a, rows[k].b,
+                 rows[k].idx - (rows[k].block == rows[split].block
+                                    ? rows[split].idx
+                                    : 0));
+    whole.finish();
+    first.finish(); // append() returns early when second is empty
+    // merged when the split falls inside a tid
+    bool merge = split > 0 && split < rows.size() && rows[split].idx > 0;
+    first.append(second, merge, merge ? rows[split].idx : 0);
+
+    const incidence_index *built[2] = {&whole, &first};
+    for (unsigned int k = 0; k < 2; k++)
+      for (unsigned int t = 0; t < num_blocks; t++)
+        for (unsigned int v = 0; v < num_vids; v++) {
+          vector<int> want, got;
+          for (unsigned int r = 0; r < rows.size(); r++)
+            if (rows[r].block == t &&
+                (rows[r].a == (int)v || rows[r].b == (int)v))
+              want.push_back(rows[r].idx);
+          pair<incidence_index::CONST_IT, incidence_index::CONST_IT> at =
+              built[k]->find(t, v);
+          for (incidence_index::CONST_IT e = at.first; e != at.second; e++)
+            got.push_back(e->second);
+          if (got != want)
+            fail("round " + to_string(round) + ": incidence_index " +
+                 (k ? "appended" : "built") + " finds other rows of vertex " +
+                 to_string(v) + " in block " + to_string(t));
+        }
+  }
+}
+
+/** Level-one patterns and VATs of a database, in the layout VAT_ST */
+template <template <typename, typename> class VAT_ST> struct layout_db {
+  typedef vat<GRAPH_PR, GRAPH_MINE_PR, VAT_ST> VAT;
+  typedef storage_manager<GRAPH_PAT, VAT, concurrent_memory_storage> VAT_MAP;
+  typedef typename VAT_MAP::VAT_HANDLE HANDLE;
+
+  pat_fam<GRAPH_PAT> pats;
+  VAT_MAP vats;
+
+  explicit layout_db(const string &path) {
+    EDGE_FREQ edge_freq;
+    db_reader<GRAPH_PAT, DMTL_TKNZ_PR> dbr(path.c_str());
+    dbr.get_length_one(pats, vats, 1, edge_freq);
+  }
+
+  ~layout_db() {
+    for (unsigned int i = 0; i < pats.size(); i++) {
+      vats.delete_vat(pats[i]);
+      delete pats[i];
+    }
+  }
+};
+
+/** A level-one edge: its end labels, one end given first */
+struct l1_edge {
+  unsigned int pat;
+  V_T from, to;
+};
+
+/** Level-one edges with an end labelled l, that end first */
+vector<l1_edge> edges_at(const pat_fam<GRAPH_PAT> &pats, const V_T &l) {
+  vector<l1_edge> found;
+  for (unsigned int i = 0; i < pats.size(); i++) {
+    if (pats[i]->label(0) == l)
+      found.push_back(l1_edge{i, l, pats[i]->label(1)});
+    else if (pats[i]->label(1) == l)
+      found.push_back(l1_edge{i, l, pats[i]->label(0)});
+  }
+  return found;
+}
+
+/**
+ * Support, tids and embeddings, in order, of a VAT made by an
+ * intersection that reported support sup; {-1} for no VAT.
+ */
+template <class VAT> vector<int> summary(VAT *v, const int &sup) {
+  if (!v)
+    return vector<int>(1, -1);
+  vector<int> out(1, sup);
+  vector<unsigned int> tids;
+  v->get_tids(tids);
+  out.push_back(tids.size());
+  out.insert(out.end(), tids.begin(), tids.end());
+  unsigned int nv = v->num_vertices();
+  v->for_each_embedding([&](const int &tid, const int *vids) {
+    out.push_back(tid);
+    out.insert(out.end(), vids, vids + nv);
+  });
+  return out;
+}
+
+/**
+ * Runs the same joins on the level-one VATs of path in the layout VAT_ST,
+ * each result under a name of its own. From each end of each level-one
+ * edge, 4 walks add up to 8 forward edges, each at the vertex the last one
+ * added, picked with a fixed seed among the frequent ones; at every step, each
+ * level-one edge that fits that vertex is joined as a back edge to every
+ * earlier vertex it may close on, as a forward edge, and as the batch of all
+ * of these. A batched candidate must give what its single join gives.
+ */
+template <template <typename, typename> class VAT_ST>
+map<string, vector<int>> run_joins(const string &path, const string &layout) {
+  typedef layout_db<VAT_ST> DB;
+  typedef typename DB::VAT VAT;
+  typedef typename DB::HANDLE HANDLE;
+  DB db(path);
+  map<string, vector<int>> out;
+  mt19937 rng(5);
+  GRAPH_PAT *live = db.pats[0]; // candidates are only tested for null
+
+  // joins v1 with the level-one VAT v2, one candidate; the VAT is kept in h
+  auto single = [&](const VAT *v1, const VAT *v2, const bool &isfwd,
+                    const pair<int, int> &vids, HANDLE &h) {
+    PAT_SUP sup;
+    PAT_SUP *sups[1] = {&sup};
+    GRAPH_PAT *cands[1] = {live};
+    VAT **c = VAT::intersection(v1, v2, sups, cands, isfwd, vids, 1);
+    h.reset(c ? c[0] : 0);
+    delete c; // a single slot
+    return summary(h.get(), sup.get_sup());
+  };
+
+  for (unsigned int i = 0; i < db.pats.size(); i++) {
+    for (int walk = 0; walk < 8; walk++) {
+      int v = walk % 2;
+      HANDLE p = db.vats.get_vat_handle(db.pats[i]);
+      vector<V_T> label;
+      label.push_back(db.pats[i]->label(0));
+      label.push_back(db.pats[i]->label(1));
+      vector<pair<int, int>> edges(1, make_pair(0, 1));
+      int t = v; // vertex the walk extends at
+      string name = to_string(i) + "." + to_string(walk);
+
+      for (unsigned int step = 0; step < 8; step++) {
+        int nv = label.size();
+        vector<l1_edge> ks = edges_at(db.pats, label[t]);
+        vector<HANDLE> next; // frequent forward joins, and their edges
+        vector<unsigned int> next_k;
+        for (unsigned int k = 0; k < ks.size(); k++) {
+          const VAT *vk = db.vats.get_vat(db.pats[ks[k].pat]);
+          string at = name + " + " + to_string(ks[k].pat) + "@" +
+                      to_string(t);
+          vector<int> dests;
+          HANDLE h;
+          for (int w = 0; w < nv; w++) {
+            bool adjacent = false;
+            for (unsigned int e = 0; e < edges.size(); e++)
+              if ((edges[e].first == t && edges[e].second == w) ||
+                  (edges[e].first == w && edges[e].second == t))
+                adjacent = true;
+            if (w == t || adjacent || !(label[w] == ks[k].to))
+              continue;
+            out[at + " back " + to_string(w)] =
+                single(p.get(), vk, false, make_pair(t, w), h);
+            dests.push_back(w);
+          }
+          out[at + " fwd"] = single(p.get(), vk, true, make_pair(t, nv), h);
+          dests.push_back(nv);
+          if (h && h->size() > 0) {
+            next.push_back(h);
+            next_k.push_back(k);
+          }
+
+          int num = dests.size();
+          vector<PAT_SUP> sups(num);
+          vector<PAT_SUP *> sup_ptrs(num);
+          vector<GRAPH_PAT *> cands(num, live);
+          for (int c = 0; c < num; c++)
+            sup_ptrs[c] = &sups[c];
+          VAT **c_vats = VAT::intersection(p.get(), vk, sup_ptrs.data(),
+                                           cands.data(), num, t,
+                                           dests.data(), 1);
+          for (int c = 0; c < num; c++) {
+            HANDLE hc(c_vats ? c_vats[c] : 0);
+            string single_name =
+                at + (dests[c] == nv ? " fwd" : " back " + to_string(dests[c]));
+            const vector<int> &want = out[single_name];
+            // a batch whose tids leave no candidate frequent gives no VATs
+            if (!c_vats && want[0] <= 0)
+              continue;
+            if (summary(hc.get(), sups[c].get_sup()) != want)
+              fail(layout + " batched " + single_name +
+                   " differs from the single join");
+          }
+          delete[] c_vats;
+        }
+        if (next.empty())
+          break;
+
+        unsigned int r = rng() % next.size();
+        p = next[r];
+        label.push_back(ks[next_k[r]].to);
+        edges.push_back(make_pair(t, nv));
+        name += " + " + to_string(ks[next_k[r]].pat) + "@" + to_string(t);
+        t = nv;
+      }
+    }
+  }
+  return out;
+}
+
+/** The minimum DFS code of pat as check_isomorphism() found it before
+ * min_dfs_search, with minimal() and extend() */
+GRAPH_PAT::CAN_CODE old_min_code(const GRAPH_PAT *pat) {
+  typedef GRAPH_PAT::CAN_CODE CAN_CODE;
+  V_T src_v = pat->label(0), dest_v = pat->label(1);
+  E_T e;
+  pat->get_out_edge(0, 1, e);
+  vector<pair<int, int>> ids;
+  iso_startup(pat, src_v, dest_v, e, ids);
+
+  vector<CAN_CODE> new_codes;
+  vector<set<CAN_CODE::FIVE_TUPLE>> covered_edges;
+  for (unsigned int i = 0; i < ids.size(); i++) {
+    CAN_CODE::FIVE_TUPLE cc_tuple(0, 1, pat->label(ids[i].first), e,
+                                  pat->label(ids[i].second));
+    new_codes.push_back(CAN_CODE(cc_tuple, ids[i].first, ids[i].second));
+    set<CAN_CODE::FIVE_TUPLE> s;
+    s.insert(CAN_CODE::FIVE_TUPLE(ids[i].first, ids[i].second, cc_tuple._li,
+                                  cc_tuple._lij, cc_tuple._lj));
+    covered_edges.push_back(s);
+  }
+  minimal(new_codes, covered_edges, pat);
+  return new_codes[0];
+}
+
+/**
+ * min_dfs_search::run() gives the code old_min_code() does, with the same
+ * pattern vertex behind every code vertex, on random connected patterns of
+ * up to 16 vertices with few labels, so that many codes tie.
+ */
+void check_min_dfs_codes() {
+  static const char *v_texts[] = {"C", "N", "O"};
+  static const char *e_texts[] = {"-", "="};
+  label_dict &dict = label_dict::instance();
+  mt19937 rng(17);
+  min_dfs_search<GRAPH_PAT> search;
+  for (unsigned int round = 0; round < 4000; round++) {
+    unsigned int n = 2 + rng() % 15;
+    unsigned int v_lbls = 1 + rng() % 3, e_lbls = 1 + rng() % 2;
+    GRAPH_PAT pat;
+    for (unsigned int v = 0; v < n; v++)
+      pat.add_vertex(dict_label(dict.id(v_texts[rng() % v_lbls])));
+
+    // a random spanning tree, with an edge between 0 and 1, then more edges
+    vector<vector<bool>> adj(n, vector<bool>(n, false));
+    unsigned int extra = rng() % (n + 1);
+    for (unsigned int k = 1; k < n + extra; k++) {
+      unsigned int a = k < n ? k : rng() % n;
+      unsigned int b = k == 1 ? 0 : k < n ? rng() % k : rng() % n;
+      if (a == b || adj[a][b])
+        continue;
+      adj[a][b] = adj[b][a] = true;
+      E_T e = dict_label(dict.id(e_texts[rng() % e_lbls]));
+      pat.add_out_edge(a, b, e);
+      pat.add_out_edge(b, a, e);
+    }
+
+    GRAPH_PAT::CAN_CODE got = search.run(&pat), want = old_min_code(&pat);
+    bool same = got.size() == want.size();
+    for (int k = 0; same && k < want.size(); k++)
+      same = got[k] == want[k];
+    for (unsigned int v = 0; same && v < n; v++)
+      same = got.gid(v) == want.gid(v);
+    if (!same)
+      fail("round " + to_string(round) + ": min_dfs_search gives " +
+           got.to_string() + " for " + want.to_string());
+  }
+}
+
+/** The arena and linked layouts give the supports, tids and embeddings of
+ * the std::vector layout, for every join of run_joins() */
+void check_vat_layouts() {
+  string path = string(DATA_DIR) + "/GRAPH_small.dat";
+  map<string, vector<int>> want = run_joins<std::vector>(path, "vector");
+  if (want.empty()) {
+    fail("no joins run on " + path);
+    return;
+  }
+  map<string, vector<int>> arena = run_joins<arena_storage>(path, "arena");
+  map<string, vector<int>> linked = run_joins<linked_storage>(path, "linked");
+  const map<string, vector<int>> *got[2] = {&arena, &linked};
+  const char *names[2] = {"arena", "linked"};
+  for (unsigned int l = 0; l < 2; l++) {
+    if (got[l]->size() != want.size())
+      fail(string(names[l]) + " layout ran " + to_string(got[l]->size()) +
+           " joins for " + to_string(want.size()));
+    for (map<string, vector<int>>::const_iterator it = want.begin();
+         it != want.end(); it++) {
+      map<string, vector<int>>::const_iterator g = got[l]->find(it->first);
+      if (g == got[l]->end() || g->second != it->second)
+        fail(string(names[l]) + " layout differs on " + it->first);
+    }
+  }
+}
+
+int main() {
+  check_varints();
+  check_code_keys<dict_label>("dict_label");
+  check_code_keys<int>("int");
+  check_code_keys<string>("string");
+  check_tid_bitsets();
+  check_min_dfs_codes();
+  check_incidence_index();
+  check_vat_layouts();
+
+  if (failures) {
+    cerr << failures << " checks failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ *  Copyright (C) 2005 M.J. Zaki <zaki@cs.rpi.edu> Rensselaer Polytechnic
+ * Institute
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/** \file walk_trace_reader.cpp - prints a summary of a walk trace written by
+ * graph_test -trace: the shape of the walks, and the percentiles and a
+ * histogram of their latencies. */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "walk_trace.h"
+
+using namespace std;
+
+char *infile;
+
+void print_usage(char *prog) {
+  cerr << "Usage: " << prog << " -i trace-filename" << endl;
+  cerr << "The trace is written by graph_test -trace" << endl;
+  exit(0);
+}
+
+void parse_args(int argc, char *argv[]) {
+  if (argc < 3) {
+    print_usage(argv[0]);
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      infile = argv[++i];
+    } else {
+      print_usage(argv[0]);
+    }
+  }
+}
+
+// the q-th quantile of sorted, by the nearest rank
+double quantile(const vector<double> &sorted, const double &q) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = (size_t)(q * sorted.size() + 0.5);
+  return sorted[rank ? min(rank, sorted.size()) - 1 : 0];
+}
+
+void print_latencies(const string &what, vector<double> us) {
+  sort(us.begin(), us.end());
+  cout << setw(10) << what << setw(8) << us.size();
+  const double qs[] = {0.5, 0.9, 0.99, 1.0};
+  for (unsigned int k = 0; k < 4; k++)
+    cout << setw(12) << fixed << setprecision(1) << quantile(us, qs[k]);
+  cout << endl;
+}
+
+/** Histogram of the latencies by powers of two microseconds */
+void print_histogram(const vector<double> &us) {
+  vector<unsigned long> buckets;
+  for (unsigned int i = 0; i < us.size(); i++) {
+    unsigned int b = 0;
+    while ((double)(1UL << b) <= us[i])
+      b++;
+    if (b >= buckets.size())
+      buckets.resize(b + 1, 0);
+    buckets[b]++;
+  }
+  unsigned long most = 0;
+  for (unsigned int b = 0; b < buckets.size(); b++)
+    most = max(most, buckets[b]);
+
+  unsigned int first = 0; // empty buckets below the first walk are skipped
+  while (!buckets[first])
+    first++;
+
+  cout << "Latency histogram (us)" << endl;
+  for (unsigned int b = first; b < buckets.size(); b++) {
+    string range = (b ? to_string(1UL << (b - 1)) : string("0")) + " - " +
+                   to_string(1UL << b);
+    cout << setw(24) << range << setw(8) << buckets[b] << " "
+         << string(most ? buckets[b] * 50 / most : 0, '#') << endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  parse_args(argc, argv);
+
+  vector<walk_record> records;
+  if (!read_walk_trace(infile, records))
+    return 1;
+  if (records.empty()) {
+    cout << "No walks in " << infile << endl;
+    return 0;
+  }
+
+  vector<double> all, fresh, dup; // latencies in microseconds
+  unsigned long steps = 0, failed = 0, edges = 0, max_edges = 0;
+  uint64_t peak_vat = 0;
+  unsigned int threads = 0;
+  for (unsigned int i = 0; i < records.size(); i++) {
+    const walk_record &r = records[i];
+    double us = r.wall_ns / 1000.0;
+    all.push_back(us);
+    (r.duplicate ? dup : fresh).push_back(us);
+    steps += r.steps;
+    failed += r.failed;
+    edges += r.edges;
+    max_edges = max(max_edges, (unsigned long)r.edges);
+    peak_vat = max(peak_vat, r.peak_vat_bytes);
+    threads = max(threads, (unsigned int)r.thread + 1);
+  }
+
+  double n = records.size();
+  cout << records.size() << " walks on " << threads << " threads, "
+       << fresh.size() << " new and " << dup.size() << " duplicate" << endl;
+  cout << fixed << setprecision(2) << "Per walk: " << steps / n
+       << " steps, " << failed / n << " failed, " << edges / n
+       << " edges (at most " << max_edges << ")" << endl;
+  cout << "Largest VAT: " << peak_vat << " bytes" << endl;
+
+  cout << "Latency percentiles (us)" << endl;
+  cout << setw(10) << "" << setw(8) << "walks" << setw(12) << "p50"
+       << setw(12) << "p90" << setw(12) << "p99" << setw(12) << "max" << endl;
+  print_latencies("all", all);
+  print_latencies("new", fresh);
+  print_latencies("duplicate", dup);
+
+  print_histogram(all);
+  return 0;
+}